@@ -0,0 +1,230 @@
+// LCR meter microbenchmarks
+// Cycles per operation and stack depth of the command and measurement hot paths
+
+//-----------------------------------------------------------------------------
+// Report
+//-----------------------------------------------------------------------------
+
+// # bench platform=<target or host> clock_hz=<system clock> overhead=<cycles> stack_paint=<bytes>
+// name,iterations,cycles_per_op,stack_bytes
+// tokenizeLine,1000,412,40
+// ...
+// # end
+//
+// Cycles exclude the per-case setup and the cost of reading the counter.
+// Stack bytes are the deepest stack use below the harness, found by painting
+// the unused stack before the case and scanning it afterwards. The paint is as
+// deep as the stack reservation allows, up to stack_paint bytes; a case that
+// used all of it is printed as stack_paint+.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "clock.h"
+#include "uart.h"
+#include "hal.h"
+#include "measure.h"
+#include "command.h"
+#include "bench.h"
+
+#define STACK_PAINT_MAX    2048    // deepest paint
+#define STACK_PAINT_MARGIN 256     // left below it for the paint helpers and interrupts
+#define STACK_PAINT        0xA5
+
+typedef struct _BENCH_CASE
+{
+    char * name;
+    uint16_t iterations;
+    void (*setup)(void);    // untimed, before every iteration
+    void (*run)(void);
+} BENCH_CASE;
+
+// keeps results live so the cases are not optimized away
+volatile uint32_t benchSink = 0;
+volatile float benchInput = 1234.5678;
+volatile float benchOutput = 0;
+volatile uint32_t benchTicks = 49382;
+char benchBuffer[20];
+
+// painted region, published so the compiler keeps the painting and the scan
+uint8_t * volatile benchStack;
+uint16_t benchStackBytes = 0;
+
+//-----------------------------------------------------------------------------
+// Cases
+//-----------------------------------------------------------------------------
+
+static char benchCommand[] = "set meas_lr 1\r";
+static COMMAND_LINE benchLine;
+
+static void setupCommand(void)
+{
+    clearCommandLine(&benchLine);
+}
+
+static void setupParsedCommand(void)
+{
+    char * c = benchCommand;
+
+    setupCommand();
+    while(!tokenizeCommandChar(&benchLine, *c++));
+}
+
+static void benchEmpty(void)
+{
+}
+
+// the whole line as it arrives from the UART, one character at a time
+static void benchTokenizeLine(void)
+{
+    char * c = benchCommand;
+
+    while(!tokenizeCommandChar(&benchLine, *c++));
+}
+
+static void benchIsCommand(void)
+{
+    benchSink += isCommand(benchLine.argc);
+}
+
+static void benchSprintfFloat(void)
+{
+    sprintf(benchBuffer, ": %f", benchInput);
+}
+
+static void benchSprintfUnsigned(void)
+{
+    sprintf(benchBuffer, ": %u", benchSink);
+}
+
+// spaces and a carriage return, harmless on the terminal reading the report
+static void benchPutsUart0(void)
+{
+    putsUart0("                \r");
+}
+
+static void benchResistanceFromTicks(void)
+{
+    benchOutput = resistanceFromTicks(benchTicks);
+}
+
+static void benchCapacitanceFromTicks(void)
+{
+    benchOutput = capacitanceFromTicks(benchTicks);
+}
+
+static const BENCH_CASE benchCases[] =
+{
+    {"tokenizeLine", 1000, setupCommand, benchTokenizeLine},
+    {"isCommand", 1000, setupParsedCommand, benchIsCommand},
+    {"sprintfFloat", 1000, 0, benchSprintfFloat},
+    {"sprintfUnsigned", 1000, 0, benchSprintfUnsigned},
+    {"putsUart0", 16, 0, benchPutsUart0},
+    {"resistanceFromTicks", 1000, 0, benchResistanceFromTicks},
+    {"capacitanceFromTicks", 1000, 0, benchCapacitanceFromTicks},
+};
+
+#define BENCH_CASES (sizeof(benchCases) / sizeof(benchCases[0]))
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// What is left of the stack reservation below the caller, less the margin, up to
+// STACK_PAINT_MAX
+static uint16_t __attribute__((noinline)) stackHeadroom(void)
+{
+    uint8_t here;
+    uintptr_t limit = getStackLimit() + STACK_PAINT_MARGIN;
+
+    if ((uintptr_t)&here <= limit)
+        return 0;
+    return (uintptr_t)&here - limit < STACK_PAINT_MAX ? (uint16_t)((uintptr_t)&here - limit) : STACK_PAINT_MAX;
+}
+
+// Both helpers get the same frame, so their arrays cover the same addresses
+// just below the caller, where the case under test will put its frames
+static void __attribute__((noinline)) paintStack(void)
+{
+    uint8_t stack[benchStackBytes];
+
+    benchStack = stack;
+    memset(benchStack, STACK_PAINT, benchStackBytes);
+}
+
+static uint16_t __attribute__((noinline)) usedStack(void)
+{
+    uint8_t stack[benchStackBytes];
+    uint16_t i;
+
+    // the stack grows down, so the untouched bytes are at the low end
+    benchStack = stack;
+    for (i = 0; i < benchStackBytes && benchStack[i] == STACK_PAINT; i++);
+    return benchStackBytes - i;
+}
+
+// Average cycles of one call, less the counter overhead
+static uint32_t timeCase(const BENCH_CASE *bench, uint32_t overhead)
+{
+    uint64_t total = 0;
+    uint32_t start;
+    uint16_t i;
+
+    for (i = 0; i < bench->iterations; i++)
+    {
+        if (bench->setup)
+            bench->setup();
+        start = getCycleCount();
+        bench->run();
+        total += (uint32_t)(getCycleCount() - start);
+    }
+    total /= bench->iterations;
+    return total > overhead ? (uint32_t)(total - overhead) : 0;
+}
+
+static uint16_t stackCase(const BENCH_CASE *bench)
+{
+    if (benchStackBytes == 0)
+        return 0;
+    if (bench->setup)
+        bench->setup();
+    paintStack();
+    bench->run();
+    return usedStack();
+}
+
+void runBenchmarks(BENCH_PRINT print)
+{
+    const BENCH_CASE empty = {"empty", 1000, 0, benchEmpty};
+    COMMAND_LINE * command = getCurrentCommand();
+    char line[80];
+    uint32_t overhead;
+    uint8_t i;
+
+    // isCommand checks the current command, point it at the benchmark line meanwhile
+    setCurrentCommand(&benchLine);
+    initCycleCounter();
+    overhead = timeCase(&empty, 0);
+    benchStackBytes = stackHeadroom();
+
+    sprintf(line, "# bench platform=%s clock_hz=%u overhead=%u stack_paint=%u\r\n", BENCH_PLATFORM, getSysClockHz(), overhead, benchStackBytes);
+    print(line);
+    print("name,iterations,cycles_per_op,stack_bytes\r\n");
+
+    for (i = 0; i < BENCH_CASES; i++)
+    {
+        uint32_t cycles = timeCase(&benchCases[i], overhead);
+        uint16_t stack = stackCase(&benchCases[i]);
+
+        sprintf(line, "%s,%u,%u,%u%s\r\n", benchCases[i].name, benchCases[i].iterations, cycles, stack,
+                stack != 0 && stack == benchStackBytes ? "+" : "");
+        print(line);
+    }
+    print("# end\r\n");
+
+    setCurrentCommand(command);
+}
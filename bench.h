@@ -0,0 +1,28 @@
+// LCR meter microbenchmarks
+// Cycles per operation and stack depth of the command and measurement hot paths
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#ifndef BENCH_PLATFORM
+#define BENCH_PLATFORM "tm4c123gh6pm"
+#endif
+
+// Report sink, putsUart0 on target and stdout on the host
+typedef void (*BENCH_PRINT)(char *str);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Prints one CSV line per hot path: name,iterations,cycles_per_op,stack_bytes
+void runBenchmarks(BENCH_PRINT print);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,44 @@
+// LCR meter component classifier
+// Decision tree over fixed-point features of the DUT probe, see classify_data.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "classify.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+int16_t classifyFeature(float volts, float vin)
+{
+    float fraction = vin > 0 ? volts / vin : 0;
+
+    if (fraction >= 1)
+        return CLASSIFY_ONE;
+    if (fraction <= -1)
+        return -CLASSIFY_ONE;
+    return (int16_t)(fraction * CLASSIFY_ONE);
+}
+
+// One compare per level, integers only
+uint8_t classifyVector(const CLASSIFY_TREE *tree, const CLASSIFY_VECTOR *vector)
+{
+    const CLASSIFY_NODE *node = &tree->nodes[0];
+
+    while (node->feature != CLASSIFY_LEAF)
+    {
+        if (vector->value[node->feature] <= node->threshold)
+            node++;
+        else
+            node = &tree->nodes[node->right];
+    }
+    return (uint8_t)node->threshold;
+}
+
+bool classifySmallCapacitor(const CLASSIFY_VECTOR *vector, int16_t charged)
+{
+    return charged >= CLASSIFY_CHARGED_MIN && (int32_t)vector->value[CLASSIFY_HIGHSIDE] * 100 < (int32_t)charged * 99;
+}
@@ -0,0 +1,66 @@
+// LCR meter component classifier
+// Decision tree over fixed-point features of the DUT probe, see classify_data.c
+
+#ifndef CLASSIFY_H_
+#define CLASSIFY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// Probe voltages as fractions of Vin in Q15, see identifyComponent (measure.c)
+typedef enum _CLASSIFY_FEATURE
+{
+    CLASSIFY_HIGHSIDE = 0,        // DUT2 through 100k right after the switch
+    CLASSIFY_STEP,                // DUT2 on 33 ohm right after the step, the ESR divider
+    CLASSIFY_LOWSIDE,             // DUT2 on 33 ohm settled, the final voltage
+    CLASSIFY_SLOPE,               // lowside - step: falls for C, rises for L
+    CLASSIFY_FEATURES
+} CLASSIFY_FEATURE;
+
+#define CLASSIFY_LEAF       0xFF
+#define CLASSIFY_ONE        32767 // feature value of Vin
+#define CLASSIFY_CHARGED_MIN 32603 // 0.995 of Vin, charged through 100k
+
+typedef struct _CLASSIFY_VECTOR
+{
+    int16_t value[CLASSIFY_FEATURES];
+} CLASSIFY_VECTOR;
+
+// Nodes in preorder: a split goes on to the next node when value[feature] <=
+// threshold and to node right otherwise; a leaf holds the COMPONENT in threshold
+typedef struct _CLASSIFY_NODE
+{
+    int16_t threshold;
+    uint8_t feature;              // CLASSIFY_FEATURE or CLASSIFY_LEAF
+    uint8_t right;
+} CLASSIFY_NODE;
+
+typedef struct _CLASSIFY_TREE
+{
+    const CLASSIFY_NODE *nodes;
+    uint8_t count;
+} CLASSIFY_TREE;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Volts to a feature, clamped to +-1
+int16_t classifyFeature(float volts, float vin);
+
+// COMPONENT (measure.h) the tree puts the features in
+uint8_t classifyVector(const CLASSIFY_TREE *tree, const CLASSIFY_VECTOR *vector);
+
+// DUT2 through 100k after the settle time (charged, scaled like the features) at
+// Vin, but not at the first sample like an open fixture: a capacitor below about
+// 2 nF, too small for the tree and for comparator timing
+bool classifySmallCapacitor(const CLASSIFY_VECTOR *vector, int16_t charged);
+
+// Generated by host/gen_classifier from labeled probes
+extern const CLASSIFY_TREE componentTree;
+
+#endif /* CLASSIFY_H_ */
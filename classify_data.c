@@ -0,0 +1,24 @@
+// LCR meter component classifier
+// Generated by host/gen_classifier (4000 parts, depth 6, 99.9 % held out correct), do not edit
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "classify.h"
+
+// {threshold, feature, right}, features in Q15 of Vin, leaves hold the COMPONENT
+static const CLASSIFY_NODE componentNodes[11] =
+{
+    {   559, CLASSIFY_SLOPE,      10},
+    { 28628, CLASSIFY_LOWSIDE,     9},
+    {   -99, CLASSIFY_SLOPE,       4},
+    {     2, CLASSIFY_LEAF,        0},   // capacitor
+    {    28, CLASSIFY_LOWSIDE,     8},
+    {  4429, CLASSIFY_HIGHSIDE,    7},
+    {     2, CLASSIFY_LEAF,        0},   // capacitor
+    {     1, CLASSIFY_LEAF,        0},   // resistor
+    {     1, CLASSIFY_LEAF,        0},   // resistor
+    {     0, CLASSIFY_LEAF,        0},   // unknown
+    {     3, CLASSIFY_LEAF,        0},   // inductor
+};
+
+const CLASSIFY_TREE componentTree = {componentNodes, 11};
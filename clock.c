@@ -0,0 +1,148 @@
+// LCR meter system clock
+// Clock profiles, tick conversions and calibrated busy waits
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz (standard) or 80 MHz (turbo)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+
+// PLL output after the DIV400 divider
+#define PLL_OUTPUT_HZ       400000000
+
+// the busy-wait loop below takes 40 clocks per pass
+#define WAIT_LOOP_CLOCKS    40
+
+// 400 MHz / divisor, programmed as divisor - 1 into SYSDIV2:SYSDIV2LSB
+const uint8_t clockDivisors[] =
+{
+    10,  // CLOCK_PROFILE_STANDARD, 40 MHz
+    5    // CLOCK_PROFILE_TURBO, 80 MHz
+};
+
+CLOCK_PROFILE clockProfile = CLOCK_PROFILE_DEFAULT;
+uint32_t sysClockHz = 40000000;
+uint32_t ticksPerUs = 40;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Program RCC2 for the requested profile, running from the crystal while the PLL relocks
+static void programPll(CLOCK_PROFILE profile)
+{
+    uint32_t divisor = clockDivisors[profile];
+
+    // Legacy RCC still selects the crystal value and main oscillator
+    SYSCTL_RCC_R = SYSCTL_RCC_XTAL_16MHZ | SYSCTL_RCC_OSCSRC_MAIN | SYSCTL_RCC_USESYSDIV | (SYSCTL_RCC_R & SYSCTL_RCC_ACG);
+
+    // Bypass the PLL while it is reprogrammed
+    SYSCTL_RCC2_R |= SYSCTL_RCC2_USERCC2 | SYSCTL_RCC2_BYPASS2;
+    SYSCTL_RCC2_R = SYSCTL_RCC2_USERCC2 | SYSCTL_RCC2_BYPASS2 | SYSCTL_RCC2_DIV400 | SYSCTL_RCC2_OSCSRC2_MO
+                  | ((divisor - 1) << 22);           // 7-bit divisor spans SYSDIV2 and SYSDIV2LSB (bit 22)
+
+    while (!(SYSCTL_PLLSTAT_R & SYSCTL_PLLSTAT_LOCK));
+    SYSCTL_RCC2_R &= ~SYSCTL_RCC2_BYPASS2;
+}
+
+// Configure HW to work with 16 MHz XTAL, PLL enabled and the profile's system clock
+void initClock(CLOCK_PROFILE profile)
+{
+    programPll(profile);
+    clockProfile = profile;
+    sysClockHz = PLL_OUTPUT_HZ / clockDivisors[profile];
+    ticksPerUs = sysClockHz / 1000000;
+}
+
+// Switch profiles at run time; callers re-derive their dividers (UART) afterwards
+void setClockProfile(CLOCK_PROFILE profile)
+{
+    if (profile != clockProfile)
+        initClock(profile);
+}
+
+CLOCK_PROFILE getClockProfile(void)
+{
+    return clockProfile;
+}
+
+uint32_t getSysClockHz(void)
+{
+    return sysClockHz;
+}
+
+uint32_t getTicksPerUs(void)
+{
+    return ticksPerUs;
+}
+
+// Timer ticks (system clock) to microseconds
+float ticksToMicroseconds(uint32_t ticks)
+{
+    return ticks / (float)ticksPerUs;
+}
+
+// Microseconds to timer ticks, saturating at the 32-bit timer range
+uint32_t microsecondsToTicks(uint32_t us)
+{
+    uint64_t ticks = (uint64_t)us * ticksPerUs;
+    return ticks > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)ticks;
+}
+
+// Busy wait for count passes of WAIT_LOOP_CLOCKS clocks
+#ifdef __TI_COMPILER_VERSION__
+// count arrives in R0
+void waitLoops(uint32_t count)
+{
+    __asm("WMS_LOOP0:   MOV  R1, #6");          // 1
+    __asm("WMS_LOOP1:   SUB  R1, #1");          // 6
+    __asm("             CBZ  R1, WMS_DONE1");   // 5+1*3
+    __asm("             NOP");                  // 5
+    __asm("             NOP");                  // 5
+    __asm("             B    WMS_LOOP1");       // 5*2 (speculative, so P=1)
+    __asm("WMS_DONE1:   SUB  R0, #1");          // 1
+    __asm("             CBZ  R0, WMS_DONE0");   // 1
+    __asm("             NOP");                  // 1
+    __asm("             B    WMS_LOOP0");       // 1*2 (speculative, so P=1)
+    __asm("WMS_DONE0:");                        // ---
+                                                // 40 clocks/pass + error
+}
+#else
+// Same loop for GCC, which doesn't leave count in R0 across statements: one asm
+// block with count in a low register (CBZ) and R1 clobbered
+__attribute__((noinline)) void waitLoops(uint32_t count)
+{
+    __asm volatile(
+        "1:     MOV  R1, #6         \n"        // 1
+        "2:     SUB  R1, #1         \n"        // 6
+        "       CBZ  R1, 3f         \n"        // 5+1*3
+        "       NOP                 \n"        // 5
+        "       NOP                 \n"        // 5
+        "       B    2b             \n"        // 5*2 (speculative, so P=1)
+        "3:     SUB  %0, #1         \n"        // 1
+        "       CBZ  %0, 4f         \n"        // 1
+        "       NOP                 \n"        // 1
+        "       B    1b             \n"        // 1*2 (speculative, so P=1)
+        "4:                         \n"        // ---
+        : "+l" (count) : : "r1", "cc");         // 40 clocks/pass + error
+}
+#endif
+
+// Approximate busy waiting (in units of microseconds), calibrated to the active profile
+void waitMicrosecond(uint32_t us)
+{
+    uint32_t loops = ((uint64_t)us * ticksPerUs) / WAIT_LOOP_CLOCKS;
+
+    if (loops > 0)
+        waitLoops(loops);
+}
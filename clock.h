@@ -0,0 +1,41 @@
+// LCR meter system clock
+// Clock profiles, tick conversions and calibrated busy waits
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// 16 MHz crystal into the 400 MHz PLL output, system clock = 400 MHz / divisor
+typedef enum _CLOCK_PROFILE
+{
+    CLOCK_PROFILE_STANDARD = 0,  // 40 MHz
+    CLOCK_PROFILE_TURBO          // 80 MHz, twice the timer resolution
+} CLOCK_PROFILE;
+
+#ifndef CLOCK_PROFILE_DEFAULT
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_STANDARD
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initClock(CLOCK_PROFILE profile);
+void setClockProfile(CLOCK_PROFILE profile);
+CLOCK_PROFILE getClockProfile(void);
+
+// Everything below derives from the active profile
+uint32_t getSysClockHz(void);
+uint32_t getTicksPerUs(void);
+float ticksToMicroseconds(uint32_t ticks);
+uint32_t microsecondsToTicks(uint32_t us);
+
+void waitMicrosecond(uint32_t us);
+
+#endif /* CLOCK_H_ */
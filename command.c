@@ -0,0 +1,386 @@
+// LCR meter command line
+// Reading, tokenizing and validating commands from UART0
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include "uart.h"
+#include "power.h"
+#include "command.h"
+#include "sequence.h"
+
+// Lines are received into the slot at queueHead and dispatched in place from
+// queueTail, so a command typed during a measurement waits in the queue
+COMMAND_LINE commandQueue[COMMAND_QUEUE_DEPTH];
+uint8_t queueHead = 0;
+uint8_t queueTail = 0;
+COMMAND_LINE * currentCommand = 0;
+
+volatile bool abortRequested = false;
+uint32_t commandOverflows = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// letters, digits and "_" make up tokens, anything else printable separates them
+static bool isTokenChar(char c){
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+void clearCommandLine(COMMAND_LINE * line){
+    line->length = 0;
+    line->text[0] = 0x0;
+    line->argc = 0;
+}
+
+// Adds one received character to the line, tokens are updated as it arrives.
+// Returns true on carriage return, the command is then ready to dispatch
+bool tokenizeCommandChar(COMMAND_LINE * line, char c){
+    if(c == 0x0D){ //CARRIAGE_RETURN
+        return true;
+    }
+    if(c == 0x08){ // if character is BACK_SPACE
+        if(line->length > 0){
+            line->length--;
+            if(isTokenChar(line->text[line->length])){
+                // the token ends here if it started at the deleted character
+                if(line->length == 0 || !isTokenChar(line->text[line->length - 1])){
+                    line->argc--;
+                }else if(line->argc <= COMMAND_MAX_TOKENS){
+                    line->tokens[line->argc - 1].length--;
+                }
+            }
+            line->text[line->length] = 0x0;
+        }
+        return false;
+    }
+    if(c < 0x20 || line->length == COMMAND_LINE_LENGTH){ // control characters, or the line is full
+        return false;
+    }
+
+    c = tolower(c);
+    if(isTokenChar(c)){
+        if(line->length == 0 || !isTokenChar(line->text[line->length - 1])){
+            // tokens past the table are counted so the command is rejected
+            if(line->argc < COMMAND_MAX_TOKENS){
+                line->tokens[line->argc].offset = line->length;
+                line->tokens[line->argc].length = 1;
+            }
+            line->argc++;
+        }else if(line->argc <= COMMAND_MAX_TOKENS){
+            line->tokens[line->argc - 1].length++;
+        }
+    }
+    line->text[line->length++] = c;
+    line->text[line->length] = 0x0;
+    return false;
+}
+
+static bool isLineToken(const COMMAND_LINE * line, uint8_t index, const char * word){
+    const COMMAND_TOKEN * token;
+
+    if(line == 0 || index >= line->argc || index >= COMMAND_MAX_TOKENS){
+        return false;
+    }
+    token = &line->tokens[index];
+    return !strncmp(&line->text[token->offset], word, token->length) && word[token->length] == 0x0;
+}
+
+// Completes the line being received: "abort" is acted on at once, anything else is queued
+static void queueCommandLine(void){
+    COMMAND_LINE * line = &commandQueue[queueHead];
+    uint8_t next = (queueHead + 1) % COMMAND_QUEUE_DEPTH;
+
+    if(line->argc == 1 && isLineToken(line, 0, "abort")){
+        // cancel the command in flight and drop the ones waiting behind it
+        abortRequested = true;
+        queueHead = currentCommand ? (queueTail + 1) % COMMAND_QUEUE_DEPTH : queueTail;
+    }else if(next == queueTail){
+        commandOverflows++;
+    }else{
+        queueHead = next;
+    }
+    clearCommandLine(&commandQueue[queueHead]);
+}
+
+// Moves received characters into the queue, call from anywhere the firmware waits
+void pollCommands(){
+    while(kbhitUart0()){
+        if(tokenizeCommandChar(&commandQueue[queueHead], getcUart0())){
+            queueCommandLine();
+        }
+    }
+}
+
+// Abort check for measurements, also keeps the queue filling while they run
+bool pollAbort(){
+    pollCommands();
+    return abortRequested;
+}
+
+// Selects the oldest queued line as the current command, without blocking
+bool nextCommand(){
+    if(queueTail == queueHead){
+        return false;
+    }
+    currentCommand = &commandQueue[queueTail];
+    abortRequested = false;
+    return true;
+}
+
+// Blocking function that returns with the next command entered by user
+void getCommand()
+{
+    pollCommands();
+    while(!nextCommand()){
+        powerIdle();
+        pollCommands();
+    }
+}
+
+// Releases the current command's slot for reception
+void finishCommand(){
+    if(currentCommand){
+        currentCommand = 0;
+        queueTail = (queueTail + 1) % COMMAND_QUEUE_DEPTH;
+    }
+}
+
+// Drops the current, queued and partly received lines
+void resetCommandArguments(){
+    queueHead = 0;
+    queueTail = 0;
+    currentCommand = 0;
+    clearCommandLine(&commandQueue[0]);
+}
+
+COMMAND_LINE * getCurrentCommand(){
+    return currentCommand;
+}
+
+void setCurrentCommand(COMMAND_LINE * line){
+    currentCommand = line;
+}
+
+char * getCommandText(){
+    return currentCommand ? currentCommand->text : "";
+}
+
+uint8_t getArgumentCount(){
+    return currentCommand ? currentCommand->argc : 0;
+}
+
+uint32_t getCommandOverflows(){
+    return commandOverflows;
+}
+
+// token compare without copying or terminating it
+bool isToken(uint8_t index, const char * word){
+    return isLineToken(currentCommand, index, word);
+}
+
+// unsigned decimal token, false if it has other characters or overflows 32 bits
+bool getTokenNumber(uint8_t index, uint32_t * value){
+    const COMMAND_TOKEN * token;
+    uint32_t number = 0;
+    uint8_t i = 0;
+
+    if(currentCommand == 0 || index >= currentCommand->argc || index >= COMMAND_MAX_TOKENS){
+        return false;
+    }
+    token = &currentCommand->tokens[index];
+    for(i = 0; i < token->length; i++){
+        char c = currentCommand->text[token->offset + i];
+        if(c < '0' || c > '9' || number > (0xFFFFFFFF - (c - '0')) / 10){
+            return false;
+        }
+        number = number * 10 + (c - '0');
+    }
+    *value = number;
+    return true;
+}
+
+//Checks for valid command and return boolean value
+bool isCommand(uint8_t argCount){
+    uint8_t i = 0;
+    uint32_t number = 0;
+    char * outputs[5] = { "meas_lr","meas_c","highside_r","lowside_r","integrate"};
+    char * commands[27] = { "t", "test","e","a","i","v","c","r","set","reset","voltage","resistor","capacitance","inductance","esr","auto", "timer", "power", "clock", "baud", "bench", "log", "dump", "seq", "trace", "record", "pf" };
+
+    for(i=0; i < 27; i++ ){
+
+        if(isToken(0, commands[i])){
+
+            //1. Check for set command
+            if(isToken(0, "set")){
+                if(argCount == 3){
+                    //2. second argument lies within the expected output terminals
+                    uint8_t j = 0;
+                    for(j =0; j < 5; j++){
+                        if(isToken(1, outputs[j])){
+                            //3. if the third argument is a valid number
+                            if(getTokenNumber(2, &number)){
+                                return true;
+                            }else{
+                                return false;
+                            }
+                        }
+                    }
+                }else{
+                   return false;
+                }
+            }
+            //2. Check for voltage command
+            else if(isToken(0, "voltage") || isToken(0, "v")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            //3. Check for resistor command
+            else if(isToken(0, "resistor") || isToken(0, "r")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            //4. Check for resistor command
+            else if(isToken(0, "reset")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            //5. Check for timer command
+            else if(isToken(0, "timer")){
+                if(argCount == 2){
+                    return true;
+                }
+            }
+            //6. Check for timer command
+            else if(isToken(0, "capacitance") || isToken(0, "c")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            //6. Check for timer command
+            else if(isToken(0, "inductance") || isToken(0, "i")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            else if(isToken(0, "pf")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "zero");
+                }
+            }
+            else if(isToken(0, "auto") || isToken(0, "a")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            else if(isToken(0, "esr") || isToken(0, "e")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            else if(isToken(0, "test") || isToken(0, "t")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            else if(isToken(0, "log")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "flush") || isToken(1, "clear");
+                }
+                if(argCount == 3 && isToken(1, "auto")){
+                    return isToken(2, "on") || isToken(2, "off");
+                }
+            }
+            else if(isToken(0, "dump")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return getTokenNumber(1, &number);
+                }
+            }
+            else if(isToken(0, "seq")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "new") || isToken(1, "show");
+                }
+                if(isToken(1, "add") && argCount <= 5){
+                    //op name, then optional arg and value
+                    uint8_t code;
+                    for(code = 0; code < SEQ_CODES; code++){
+                        if(isToken(2, getSequenceOpName(code))){
+                            return (argCount < 4 || getTokenNumber(3, &number)) &&
+                                   (argCount < 5 || getTokenNumber(4, &number));
+                        }
+                    }
+                    return false;
+                }
+                if(argCount == 3 && (isToken(1, "show") || isToken(1, "save") || isToken(1, "erase") || isToken(1, "run"))){
+                    return getTokenNumber(2, &number) && number < SEQ_USER_SLOTS;
+                }
+            }
+            else if(isToken(0, "trace")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "start") || isToken(1, "stop") || isToken(1, "vcd");
+                }
+            }
+            else if(isToken(0, "record")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "on") || isToken(1, "off") || isToken(1, "dump");
+                }
+            }
+            else if(isToken(0, "bench")){
+                if(argCount == 1){
+                    return true;
+                }
+            }
+            else if(isToken(0, "baud")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2 && getTokenNumber(1, &number)){
+                    return isUart0BaudSupported(number);
+                }
+            }
+            else if(isToken(0, "clock")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "40") || isToken(1, "80");
+                }
+            }
+            else if(isToken(0, "power")){
+                if(argCount == 1){
+                    return true;
+                }
+                if(argCount == 2){
+                    return isToken(1, "run") || isToken(1, "sleep") || isToken(1, "deep");
+                }
+            }
+        }
+    }
+    return false;
+}
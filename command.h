@@ -0,0 +1,63 @@
+// LCR meter command line
+// Reading, tokenizing and validating commands from UART0
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// characters per line, the buffer also holds the terminator
+#define COMMAND_LINE_LENGTH 80
+#define COMMAND_MAX_TOKENS  8
+
+// lines held while a measurement runs, one slot is always receiving
+#define COMMAND_QUEUE_DEPTH 8
+
+// token inside the line text, nothing is copied or terminated
+typedef struct _COMMAND_TOKEN
+{
+    uint8_t offset;
+    uint8_t length;
+} COMMAND_TOKEN;
+
+// line as typed (lowercase, always terminated), argc also counts tokens past the table
+typedef struct _COMMAND_LINE
+{
+    char text[COMMAND_LINE_LENGTH + 1];
+    uint8_t length;
+    uint8_t argc;
+    COMMAND_TOKEN tokens[COMMAND_MAX_TOKENS];
+} COMMAND_LINE;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void clearCommandLine(COMMAND_LINE * line);
+bool tokenizeCommandChar(COMMAND_LINE * line, char c);
+
+// Background reception: pollCommands drains UART0 into the queue,
+// an "abort" line cancels the command in flight instead of queueing
+void pollCommands();
+bool pollAbort();
+bool nextCommand();
+void getCommand();
+void finishCommand();
+void resetCommandArguments();
+uint32_t getCommandOverflows();
+
+// The command being dispatched
+COMMAND_LINE * getCurrentCommand();
+void setCurrentCommand(COMMAND_LINE * line);
+char * getCommandText();
+uint8_t getArgumentCount();
+bool isToken(uint8_t index, const char * word);
+bool getTokenNumber(uint8_t index, uint32_t * value);
+bool isCommand(uint8_t argCount);
+
+#endif /* COMMAND_H_ */
@@ -0,0 +1,64 @@
+// LCR meter EEPROM
+// Word access to the 2 KB on-chip EEPROM (32 blocks of 16 words)
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    see clock.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "eeprom.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void waitEeprom(void)
+{
+    while (EEPROM_EEDONE_R & EEPROM_EEDONE_WORKING);
+}
+
+// Power-up sequence from the data sheet: clock, wait for the controller, check that
+// an earlier interrupted write was recovered
+bool initEeprom(void)
+{
+    SYSCTL_RCGCEEPROM_R |= SYSCTL_RCGCEEPROM_R0;
+    while (!(SYSCTL_PREEPROM_R & SYSCTL_PREEPROM_R0));
+    waitEeprom();
+    return !(EEPROM_EESUPP_R & (EEPROM_EESUPP_PRETRY | EEPROM_EESUPP_ERETRY));
+}
+
+void readEeprom(uint16_t address, uint32_t *data, uint16_t words)
+{
+    while (words--)
+    {
+        EEPROM_EEBLOCK_R = address / EEPROM_WORDS_PER_BLOCK;
+        EEPROM_EEOFFSET_R = address % EEPROM_WORDS_PER_BLOCK;
+        *data++ = EEPROM_EERDWR_R;
+        address++;
+    }
+}
+
+// Blocking, each word takes a few hundred microseconds (longer if a copy buffer erase is due)
+bool writeEeprom(uint16_t address, const uint32_t *data, uint16_t words)
+{
+    while (words--)
+    {
+        EEPROM_EEBLOCK_R = address / EEPROM_WORDS_PER_BLOCK;
+        EEPROM_EEOFFSET_R = address % EEPROM_WORDS_PER_BLOCK;
+        EEPROM_EERDWR_R = *data++;
+        waitEeprom();
+        if (EEPROM_EEDONE_R)
+            return false;
+        address++;
+    }
+    return true;
+}
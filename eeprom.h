@@ -0,0 +1,28 @@
+// LCR meter EEPROM
+// Word access to the 2 KB on-chip EEPROM (32 blocks of 16 words)
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define EEPROM_BLOCKS          32
+#define EEPROM_WORDS_PER_BLOCK 16
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// False if the EEPROM could not recover from an interrupted write
+bool initEeprom(void);
+
+// Word address = block * EEPROM_WORDS_PER_BLOCK + offset
+void readEeprom(uint16_t address, uint32_t *data, uint16_t words);
+bool writeEeprom(uint16_t address, const uint32_t *data, uint16_t words);
+
+#endif /* EEPROM_H_ */
@@ -0,0 +1,607 @@
+// LCR meter hardware abstraction
+// TM4C123 implementation of hal.h
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    see clock.c
+
+// Hardware configuration:
+// Output terminals:
+//   MEAS_C (PA5), HIGHSIDE_R (PD2), INTEGRATE (PE1), MEAS_LR (PE4), LOWSIDE_R (PE5)
+// DUT voltages:
+//   DUT1 on AN11 (PB5) through ADC0 SS3, DUT2 on AN10 (PB4) through ADC1 SS3
+// Analog comparator 0:
+//   C0- (PC7) against the internal reference, timed by wide timer 5A
+// Wide timer 5A:
+//   32-bit free-running capture timebase on the system clock, never reset; a
+//   capture keeps its own start stamp
+// Wide timer 4:
+//   64-bit free-running uptime counter on PIOSC, independent of the clock profile
+// Watchdog 0:
+//   command and measurement deadlines on the system clock, interrupt then reset
+// Flash:
+//   page at 0x3FC00 holds data written at run time (user sequences)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "uart.h"
+#include "power.h"
+#include "hal.h"
+#include "trace.h"
+#include "record.h"
+
+// Cortex-M4 data watchpoint and trace unit (not in tm4c123gh6pm.h)
+#define CORE_DEMCR_R     (*((volatile uint32_t *)0xE000EDFC))
+#define CORE_DEMCR_TRCENA 0x01000000
+#define DWT_CTRL_R       (*((volatile uint32_t *)0xE0001000))
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT_R     (*((volatile uint32_t *)0xE0001004))
+
+// Masked GPIODATA on the APB ports: address bits 9:2 select the pins a store
+// changes and a read returns, the rest of the port is left alone
+#define PORTA_MASKED(pins) (*((volatile uint32_t *)(0x40004000 + ((pins) << 2))))
+#define PORTD_MASKED(pins) (*((volatile uint32_t *)(0x40007000 + ((pins) << 2))))
+#define PORTE_MASKED(pins) (*((volatile uint32_t *)(0x40024000 + ((pins) << 2))))
+
+// uptime counter clock
+#define PIOSC_TICKS_PER_US 16
+
+// comparator reference after a level change
+#define COMPARATOR_SETTLE_US 10
+
+// Last 1 KB page of the 256 KB flash. tm4c123gh6pm.ld keeps it out of the image;
+// for CCS the image is far smaller, the .cmd file has to as well if it grows near it.
+#define USER_FLASH_ADDRESS 0x0003FC00
+#define FLASH_KEY_BOOTCFG  0xA4420000                // write key when BOOTCFG.KEY is set
+#define FLASH_KEY_DEFAULT  0x71D50000
+
+// timer value latched by the comparator interrupt
+uint32_t resistor_time_value = 0;
+volatile uint32_t captureStart = 0;                  // timebase at startCapture
+
+// Single producer (analogComparator05Isr), single consumer (getCaptureEdge): the
+// interrupt only writes captureHead, the consumer only captureTail
+CAPTURE_EDGE captureQueue[CAPTURE_QUEUE_DEPTH];
+volatile uint8_t captureHead = 0;
+volatile uint8_t captureTail = 0;
+volatile uint32_t captureOverflows = 0;
+
+uint8_t comparatorLevels[COMPARATOR_LEVELS_MAX] = {COMPARATOR_LEVEL_DEFAULT};
+uint8_t comparatorLevelCount = 1;
+volatile uint8_t comparatorLevelIndex = 0;
+
+bool watchdogReset = false;
+volatile bool watchdogTimedOut = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Initialize Hardware
+void initSerialHw()
+{
+    // Configure HW to work with 16 MHz XTAL, PLL enabled, system clock from the default profile
+    initClock(CLOCK_PROFILE_DEFAULT);
+
+    // Set GPIO ports to use APB (not needed since default configuration -- for clarity)
+    // Note UART on port A must use APB
+    SYSCTL_GPIOHBCTL_R = 0;
+
+    // Enable GPIO port A and F peripherals
+    SYSCTL_RCGC2_R = SYSCTL_RCGC2_GPIOA | SYSCTL_RCGC2_GPIOF |SYSCTL_RCGC2_GPIOD | SYSCTL_RCGC2_GPIOE | SYSCTL_RCGC2_GPIOB | SYSCTL_RCGC2_GPIOC ;
+
+    // Configure LED and pushbutton pins
+    GPIO_PORTF_DIR_R = 0x0B;  // bits 0,1 and 3 are outputs, other pins are inputs
+    GPIO_PORTF_DR2R_R = 0x0B; // set drive strength to 2mA (not needed since default configuration -- for clarity)
+    GPIO_PORTF_DEN_R = 0x1B;  // enable LEDs and pushbuttons
+    GPIO_PORTF_PUR_R = 0x10;  // enable internal pull-up for push button
+
+    // Configure circuit output pins
+    GPIO_PORTA_DIR_R = 0x20; //bit 5 for output MEAS_C
+    GPIO_PORTA_DR2R_R = 0x20; // set drive strength to 2mA
+    GPIO_PORTA_DEN_R = 0x20;  // enable PIN
+
+    GPIO_PORTD_DIR_R = 0x04; //bit 2 for output HiGHSIDE_R
+    GPIO_PORTD_DR2R_R = 0x04; // set drive strength to 2mA
+    GPIO_PORTD_DEN_R = 0x04;  // enable PIN
+
+    GPIO_PORTE_DIR_R = 0x32; //bits 1,4 and 5 for output INTEGRATE, MEAS_LR and LOWSIDE_R respectively
+    GPIO_PORTE_DR2R_R = 0x32; // set drive strength to 2mA
+    GPIO_PORTE_DEN_R = 0x32;  // enable PIN
+
+    //drive output pins to zero
+    GPIO_PORTA_DATA_R &= ~(0x20);
+    GPIO_PORTD_DATA_R &= ~(0x04);
+    GPIO_PORTE_DATA_R &= ~(0x32);
+
+    // Configure UART0 to 115200 baud, 8N1 format
+    initUart0(UART0_DEFAULT_BAUD);
+
+    // Configure AN10(PB4),AN11(PB5) as an analog input to DUT2,DUT1 respectively
+    SYSCTL_RCGCADC_R |= 0x03;                        // turn on ADC module 0 clocking
+    GPIO_PORTB_AFSEL_R |= 0x30;                      // select alternative functions for AN11 nad AN10 (PB4,PB5)
+    GPIO_PORTB_DEN_R &= ~0x30;                       // turn off digital operation on pin PB4,PB5
+    GPIO_PORTB_AMSEL_R |= 0x30;                      // turn on analog operation on pin PB4,PB5
+
+    ADC1_CC_R = ADC_CC_CS_SYSPLL;                    // select PLL as the time base (not needed, since default value)
+    ADC1_ACTSS_R &= ~ADC_ACTSS_ASEN3;                // disable sample sequencer 3 (SS3) for programming
+    ADC1_EMUX_R = ADC_EMUX_EM3_PROCESSOR;            // select SS3 bit in ADCPSSI as trigger
+    ADC1_SSMUX3_R = 10;                               // set first sample to AN0
+    ADC1_SSCTL3_R = ADC_SSCTL3_END0;                 // mark first sample as the end
+    ADC1_ACTSS_R |= ADC_ACTSS_ASEN3;                 // enable SS3 for operation
+
+    ADC0_CC_R = ADC_CC_CS_SYSPLL;                    // select PLL as the time base (not needed, since default value)
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN3;                // disable sample sequencer 3 (SS3) for programming
+    ADC0_EMUX_R = ADC_EMUX_EM3_PROCESSOR;            // select SS3 bit in ADCPSSI as trigger
+    ADC0_SSMUX3_R = 11;                               // set first sample to AN0
+    ADC0_SSCTL3_R = ADC_SSCTL3_END0;                 // mark first sample as the end
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN3;                 // enable SS3 for operation
+
+    // capture timebase: free-running, read by the comparator interrupt, nothing zeroes it
+    SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R5;     // turn-on timer
+    while (!(SYSCTL_PRWTIMER_R & SYSCTL_PRWTIMER_R5));
+    WTIMER5_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off counter before reconfiguring
+    WTIMER5_CFG_R = 4;                               // configure as 32-bit counter (A only)
+    WTIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR; // periodic, count up
+    WTIMER5_TAILR_R = 0xFFFFFFFF;                    // wrap at the full 32 bits
+    WTIMER5_IMR_R = 0;                               // no timer interrupts
+    WTIMER5_TAV_R = 0;
+    WTIMER5_CTL_R |= TIMER_CTL_TAEN;  // turn-on Timer
+
+    //configure analog comparator
+    SYSCTL_RCGCACMP_R |= SYSCTL_RCGCACMP_R0;
+
+    // Configure Analog comparator input pins
+    GPIO_PORTC_DIR_R &=  ~(0x80);//~(0xC0); //bit 7 and 6 input for analog comparator, PC7,PC6
+    GPIO_PORTC_DEN_R &=  ~(0x80);//~(0x80);  // disable PIN
+    GPIO_PORTC_AMSEL_R |= 0x80;  // turn on analog operation on pin PC7
+    GPIO_PORTC_AFSEL_R |= 0x80;  // select alternative functions
+
+    COMP_ACREFCTL_R |= (COMP_ACREFCTL_EN | COMP_ACREFCTL_VREF_M); // EN = 1, VDDA = 3.3V // 0x40c
+
+
+    COMP_ACREFCTL_R &= ~(COMP_ACREFCTL_RNG); //RNG = 0x20f
+    COMP_ACCTL0_R |= (COMP_ACCTL0_ASRCP_REF | COMP_ACCTL0_ISEN_M); // COMP_ACCTL0_ISEN_RISE | COMP_ACCTL0_TSEN_RISE); //0x40c COMP_ACCTL0_CINV
+
+    // interrupt configuration, the NVIC line stays off until startCapture
+    NVIC_DIS0_R = 1 << (INT_COMP0-16);               // turn-off interrupt 41 (COMP0)
+    COMP_ACMIS_R = COMP_ACMIS_IN0;                   // clear a trip from power-up
+    COMP_ACINTEN_R |= COMP_ACINTEN_IN0;
+
+    // uptime for log timestamps, runs from PIOSC so clock switches and deep-sleep don't disturb it
+    SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R4;
+    while (!(SYSCTL_PRWTIMER_R & SYSCTL_PRWTIMER_R4));
+    WTIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+    WTIMER4_CFG_R = TIMER_CFG_32_BIT_TIMER;          // concatenated, 64-bit on a wide timer
+    WTIMER4_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR;
+    WTIMER4_TAILR_R = 0xFFFFFFFF;
+    WTIMER4_TBILR_R = 0xFFFFFFFF;
+    SYSCTL_ALTCLKCFG_R = SYSCTL_ALTCLKCFG_ALTCLK_PIOSC;
+    WTIMER4_CC_R = TIMER_CC_ALTCLK;
+    WTIMER4_TAV_R = 0;
+    WTIMER4_TBV_R = 0;
+    WTIMER4_CTL_R |= TIMER_CTL_TAEN;
+
+    // clock gating and low-power idle
+    initPower();
+
+    // a command that hangs is stopped by the watchdog
+    initWatchdog();
+}
+
+// Port reads only while tracing, the writes stay back to back otherwise
+static void traceWrite()
+{
+    if (isTraceRunning())
+        traceTerminals(getTerminals());
+}
+
+// Terminal pins on port E
+static uint32_t portEPins(uint8_t terminal)
+{
+    uint32_t pins = 0;
+
+    if (terminal & TERMINAL_MEAS_LR) pins |= 0x10;
+    if (terminal & TERMINAL_LOWSIDE_R) pins |= 0x20;
+    if (terminal & TERMINAL_INTEGRATE) pins |= 0x02;
+    return pins;
+}
+
+// Drive one or more output terminals high or low. Every port takes a single
+// masked store, so the port E terminals named together switch on the same
+// cycle and nothing else on the port is touched. Each store is traced on its
+// own, so the skew between ports shows up.
+void setTerminal(uint8_t terminal, bool on)
+{
+    uint32_t pins = portEPins(terminal);
+
+    if (terminal & TERMINAL_MEAS_C)
+    {
+        PORTA_MASKED(0x20) = on ? 0x20 : 0;
+        traceWrite();
+    }
+    if (terminal & TERMINAL_HIGHSIDE_R)
+    {
+        PORTD_MASKED(0x04) = on ? 0x04 : 0;
+        traceWrite();
+    }
+    if (pins)
+    {
+        PORTE_MASKED(pins) = on ? pins : 0;
+        traceWrite();
+    }
+}
+
+// Port E first, it holds MEAS_LR, the Vdd side of DUT1
+void resetOutputTerminals(){
+
+    PORTE_MASKED(0x32) = 0;
+    traceWrite();
+    PORTA_MASKED(0x20) = 0;
+    traceWrite();
+    PORTD_MASKED(0x04) = 0;
+    traceWrite();
+}
+
+// Read back from the port data registers
+uint8_t getTerminals()
+{
+    uint32_t portE = PORTE_MASKED(0x32);
+    uint8_t terminals = 0;
+
+    if (portE & 0x10) terminals |= TERMINAL_MEAS_LR;
+    if (PORTA_MASKED(0x20)) terminals |= TERMINAL_MEAS_C;
+    if (PORTD_MASKED(0x04)) terminals |= TERMINAL_HIGHSIDE_R;
+    if (portE & 0x20) terminals |= TERMINAL_LOWSIDE_R;
+    if (portE & 0x02) terminals |= TERMINAL_INTEGRATE;
+    return terminals;
+}
+
+// To read Analog Input
+int16_t readAdc0Ss3()
+{
+    int16_t sample;
+
+    ADC0_PSSI_R |= ADC_PSSI_SS3;                     // set start bit
+    while (ADC0_ACTSS_R & ADC_ACTSS_BUSY);           // wait until SS3 is not busy
+    sample = ADC0_SSFIFO3_R;                         // get single result from the FIFO
+    recordInput(RECORD_ADC0, 0, sample, 0, 0);
+    return sample;
+}
+
+int16_t readAdc1Ss3()
+{
+    int16_t sample;
+
+    ADC1_PSSI_R |= ADC_PSSI_SS3;                     // set start bit
+    while (ADC1_ACTSS_R & ADC_ACTSS_BUSY);           // wait until SS3 is not busy
+    sample = ADC1_SSFIFO3_R;                         // get single result from the FIFO
+    recordInput(RECORD_ADC1, 0, 0, sample, 0);
+    return sample;
+}
+
+// Both sequencers wait on SYNCWAIT and start together on GSYNC. Sample times
+// come from SysTick, which initPower leaves free-running at the system clock
+void readAdcBurst(ADC_PAIR *samples, uint16_t count)
+{
+    uint32_t start = NVIC_ST_CURRENT_R;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        ADC0_PSSI_R = ADC_PSSI_SS3 | ADC_PSSI_SYNCWAIT;
+        ADC1_PSSI_R = ADC_PSSI_SS3 | ADC_PSSI_SYNCWAIT;
+        ADC0_PSSI_R = ADC_PSSI_GSYNC;
+        while ((ADC0_ACTSS_R | ADC1_ACTSS_R) & ADC_ACTSS_BUSY);
+        samples[i].dut1 = ADC0_SSFIFO3_R;
+        samples[i].dut2 = ADC1_SSFIFO3_R;
+        samples[i].ticks = (start - NVIC_ST_CURRENT_R) & 0x00FFFFFF;
+    }
+
+    // recorded after the burst, so the sample spacing stays as it was
+    for (i = 0; i < count; i++)
+        recordInput(RECORD_PAIR, samples[i].ticks, samples[i].dut1, samples[i].dut2, 0);
+}
+
+// Reference level, RNG stays 0 (high range)
+static void setComparatorReference(uint8_t level)
+{
+    COMP_ACREFCTL_R = COMP_ACREFCTL_EN | (level & COMP_ACREFCTL_VREF_M);
+}
+
+void setComparatorLevels(const uint8_t *levels, uint8_t count)
+{
+    uint8_t i;
+
+    if (count == 0)
+    {
+        comparatorLevels[0] = COMPARATOR_LEVEL_DEFAULT;
+        count = 1;
+    }
+    else
+    {
+        if (count > COMPARATOR_LEVELS_MAX)
+            count = COMPARATOR_LEVELS_MAX;
+        for (i = 0; i < count; i++)
+            comparatorLevels[i] = levels[i];
+    }
+    comparatorLevelCount = count;
+}
+
+bool getCaptureEdge(CAPTURE_EDGE *edge)
+{
+    uint8_t tail = captureTail;
+
+    if (tail == captureHead)
+    {
+        recordInput(RECORD_NO_EDGE, 0, 0, 0, 0);
+        return false;
+    }
+    *edge = captureQueue[tail % CAPTURE_QUEUE_DEPTH];
+    captureTail = tail + 1;                          // the slot is free once the copy is done
+    recordInput(RECORD_EDGE, edge->ticks, 0, 0, edge->level);
+    return true;
+}
+
+uint32_t getCaptureOverflows()
+{
+    return captureOverflows;
+}
+
+// Stamp the timebase and let comparator edges latch the time since. The stamp is
+// taken before the interrupt is armed, and a trip still pending from the last
+// capture is dropped, so the first edge can't see a stale start.
+void startCapture()
+{
+    NVIC_DIS0_R = 1 << (INT_COMP0-16);
+    resistor_time_value = 0; // no edge yet, a missed one must not report the last capture
+    captureTail = captureHead;                       // drop edges nobody read
+    comparatorLevelIndex = 0;
+    setComparatorReference(comparatorLevels[0]);
+    COMP_ACMIS_R = COMP_ACMIS_IN0;
+    NVIC_UNPEND0_R = 1 << (INT_COMP0-16);
+    captureStart = WTIMER5_TAV_R;
+    NVIC_EN0_R = 1 << (INT_COMP0-16);                // turn-on interrupt 41 (COMP0)
+}
+
+void stopCapture()
+{
+    NVIC_DIS0_R = 1 << (INT_COMP0-16);               // turn-off interrupt 41 (COMP0)
+}
+
+uint32_t getCaptureTicks()
+{
+    uint32_t ticks = resistor_time_value;
+
+    recordInput(RECORD_CAPTURE, ticks, 0, 0, 0);
+    return ticks;
+}
+
+// Ends a charge transfer phase one phase after the previous one ended, so the port
+// writes and the comparator poll fall inside the phases instead of adding to every
+// cycle. Behind by a whole phase (an interrupt), the next one starts from now.
+static uint32_t endPhase(uint32_t start, uint32_t phase)
+{
+    uint32_t now;
+
+    while ((now = WTIMER5_TAV_R) - start < phase);
+    start += phase;
+    return now - start >= phase ? now : start;
+}
+
+// Straight port writes and a comparator poll, nothing else in the loop. The phases
+// are timed back to back on the capture timebase, a cycle takes 2 * CHARGE_PHASE_US
+// whatever the writes cost. An interrupt takes what it overruns off the next phase,
+// or restarts the timing past a whole one. Break-before-make:
+// the integrator is never on with LOWSIDE_R and MEAS_LR never with MEAS_C. Not
+// traced, a burst would fill the trace.
+uint32_t countChargeTransfers(uint8_t level, uint32_t max_cycles)
+{
+    uint32_t phase = microsecondsToTicks(CHARGE_PHASE_US);
+    uint32_t start;
+    uint32_t cycles = 0;
+    bool tripped = false;
+
+    setComparatorReference(level);
+    waitMicrosecond(COMPARATOR_SETTLE_US);
+    start = WTIMER5_TAV_R;
+    while (!tripped && cycles < max_cycles)
+    {
+        // empty the DUT, the integrator holds its charge
+        PORTE_MASKED(0x12) = 0;                      // MEAS_LR, INTEGRATE off
+        PORTE_MASKED(0x20) = 0x20;                   // LOWSIDE_R on
+        PORTA_MASKED(0x20) = 0x20;                   // MEAS_C on
+        start = endPhase(start, phase);
+
+        // push its charge into the integrator
+        PORTA_MASKED(0x20) = 0;
+        PORTE_MASKED(0x20) = 0;
+        PORTE_MASKED(0x12) = 0x12;                   // MEAS_LR, INTEGRATE on
+        start = endPhase(start, phase);
+
+        cycles++;
+        tripped = !(COMP_ACSTAT0_R & COMP_ACSTAT0_OVAL);
+    }
+    resetOutputTerminals();
+    setComparatorReference(COMPARATOR_LEVEL_DEFAULT);
+
+    if (!tripped)
+        cycles = 0;
+    recordInput(RECORD_CHARGE, cycles, 0, 0, level);
+    return cycles;
+}
+
+// DUT2 is on C0-, the reference on C0+: the output drops when DUT2 rises past the
+// reference. Edges back up (the reference stepping, or noise) are not trips.
+void analogComparator05Isr(){
+    uint32_t ticks = WTIMER5_TAV_R - captureStart;   // modulo 2^32, right across a wrap
+    uint8_t head = captureHead;
+    uint8_t index = comparatorLevelIndex;
+
+    if(!(COMP_ACSTAT0_R & COMP_ACSTAT0_OVAL)){
+        //  resistor time constant
+        resistor_time_value = ticks;
+
+        if((uint8_t)(head - captureTail) < CAPTURE_QUEUE_DEPTH){
+            captureQueue[head % CAPTURE_QUEUE_DEPTH].ticks = ticks;
+            captureQueue[head % CAPTURE_QUEUE_DEPTH].level = comparatorLevels[index];
+            captureHead = head + 1;                  // publish after the slot is written
+        }else{
+            captureOverflows++;
+        }
+
+        // next threshold of this charge
+        if(index + 1 < comparatorLevelCount){
+            comparatorLevelIndex = index + 1;
+            setComparatorReference(comparatorLevels[index + 1]);
+        }
+    }
+    // reset the interrupt, write-one-to-clear so only this comparator's bit
+    COMP_ACMIS_R = COMP_ACMIS_IN0;
+}
+
+// Enable the DWT cycle counter, counts system clock cycles
+void initCycleCounter()
+{
+    CORE_DEMCR_R |= CORE_DEMCR_TRCENA;
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+}
+
+uint32_t getCycleCount()
+{
+    return DWT_CYCCNT_R;
+}
+
+#ifdef __TI_COMPILER_VERSION__
+extern uint8_t __stack;                 // start of .stack, --stack_size below __STACK_END
+#define STACK_LIMIT __stack
+#else
+extern uint8_t _stack_limit;            // tm4c123gh6pm.ld, STACK_SIZE below _stack_top
+#define STACK_LIMIT _stack_limit
+#endif
+
+uintptr_t getStackLimit()
+{
+    return (uintptr_t)&STACK_LIMIT;
+}
+
+// The capture timebase is never reset and keeps counting while the core sleeps,
+// unlike the cycle counter (stopped in WFI and zeroed by bench)
+uint32_t getTraceTicks()
+{
+    return WTIMER5_TAV_R;
+}
+
+const uint32_t * getUserFlash()
+{
+    return (const uint32_t *)USER_FLASH_ADDRESS;
+}
+
+// Page erase then one word at a time. The core stalls on flash fetches while the
+// controller is busy, so nothing else is needed to keep code from running off it.
+bool writeUserFlash(const uint32_t *page)
+{
+    uint32_t key = (FLASH_BOOTCFG_R & FLASH_BOOTCFG_KEY) ? FLASH_KEY_BOOTCFG : FLASH_KEY_DEFAULT;
+    uint16_t i;
+
+    FLASH_FCMISC_R = FLASH_FCMISC_AMISC | FLASH_FCMISC_ERMISC | FLASH_FCMISC_PMISC;
+    FLASH_FMA_R = USER_FLASH_ADDRESS;
+    FLASH_FMC_R = key | FLASH_FMC_ERASE;
+    while (FLASH_FMC_R & FLASH_FMC_ERASE);
+
+    for (i = 0; i < USER_FLASH_WORDS; i++)
+    {
+        if (page[i] == 0xFFFFFFFF)
+            continue;                                // erased already
+        FLASH_FMA_R = USER_FLASH_ADDRESS + i * 4;
+        FLASH_FMD_R = page[i];
+        FLASH_FMC_R = key | FLASH_FMC_WRITE;
+        while (FLASH_FMC_R & FLASH_FMC_WRITE);
+    }
+
+    if (FLASH_FCRIS_R & (FLASH_FCRIS_ARIS | FLASH_FCRIS_ERRIS | FLASH_FCRIS_PROGRIS))
+        return false;
+    return memcmp((const void *)USER_FLASH_ADDRESS, page, USER_FLASH_WORDS * 4) == 0;
+}
+
+// Microseconds since reset, upper half re-read in case the lower half wrapped in between
+uint64_t getUptimeUs()
+{
+    uint32_t high;
+    uint32_t low;
+
+    do
+    {
+        high = WTIMER4_TBV_R;
+        low = WTIMER4_TAV_R;
+    } while (high != WTIMER4_TBV_R);
+
+    return ((((uint64_t)high) << 32) | low) / PIOSC_TICKS_PER_US;
+}
+
+// Counts down from the load, the interrupt at the first timeout is left pending
+// until rearmWatchdog, so a second one resets the chip
+void initWatchdog()
+{
+    if (SYSCTL_RESC_R & SYSCTL_RESC_WDT0)
+    {
+        watchdogReset = true;
+        SYSCTL_RESC_R &= ~SYSCTL_RESC_WDT0;
+    }
+    SYSCTL_RCGCWD_R |= SYSCTL_RCGCWD_R0;
+    while (!(SYSCTL_PRWD_R & SYSCTL_PRWD_R0));
+    loadWatchdog(WATCHDOG_COMMAND_US);
+    WATCHDOG0_CTL_R |= WDT_CTL_RESEN | WDT_CTL_INTEN; // INTEN only clears on reset
+    NVIC_EN0_R = 1 << (INT_WATCHDOG-16);             // turn-on interrupt 18 (WATCHDOG)
+}
+
+// Longer than the counter holds at the clock runs as long as it can
+void loadWatchdog(uint32_t us)
+{
+    uint64_t ticks = (uint64_t)us * getTicksPerUs();
+
+    WATCHDOG0_LOAD_R = ticks > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)ticks;
+}
+
+void feedWatchdog()
+{
+    WATCHDOG0_LOAD_R = WATCHDOG0_LOAD_R;
+}
+
+bool wasWatchdogReset()
+{
+    return watchdogReset;
+}
+
+// The timed-out command got back to the loop: clear the first timeout (reloading
+// the count) and unmask the interrupt again
+void rearmWatchdog()
+{
+    if (!watchdogTimedOut)
+        return;
+    watchdogTimedOut = false;
+    WATCHDOG0_ICR_R = 0;
+    NVIC_UNPEND0_R = 1 << (INT_WATCHDOG-16);
+    NVIC_EN0_R = 1 << (INT_WATCHDOG-16);
+}
+
+// First timeout: the core may be stuck with the DUT driven, so the outputs go off
+// here. Masked rather than cleared, the next timeout resets the chip unless the
+// command is torn down and rearmWatchdog runs first.
+void watchdogIsr()
+{
+    resetOutputTerminals();
+    NVIC_DIS0_R = 1 << (INT_WATCHDOG-16);
+    watchdogTimedOut = true;
+}
@@ -0,0 +1,126 @@
+// LCR meter hardware abstraction
+// Everything the measurement engine needs from the board; hal.c implements it on
+// the TM4C123, host/sim_hal.c against the simulated analog front end
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// Output terminals, bit flags so several can be named at once
+#define TERMINAL_MEAS_LR     0x01  // PE4, DUT1 to Vdd
+#define TERMINAL_MEAS_C      0x02  // PA5, DUT1 to ground
+#define TERMINAL_HIGHSIDE_R  0x04  // PD2, DUT2 to Vdd through 100k
+#define TERMINAL_LOWSIDE_R   0x08  // PE5, DUT2 to ground through 33 ohm
+#define TERMINAL_INTEGRATE   0x10  // PE1, DUT2 to ground through 1 uF
+#define TERMINAL_ALL         0x1F
+
+// LOWSIDE_R as DUT2 sees it, switch included: the inductance calibration's 52.14
+// is 40 * LOWSIDE_R_OHM / 33 per ln(Vin / (Vin - Vref))
+#define LOWSIDE_R_OHM        35.171898
+
+// One simultaneous DUT1/DUT2 conversion, ticks (system clock) after the burst started
+typedef struct _ADC_PAIR
+{
+    int16_t dut1;
+    int16_t dut2;
+    uint32_t ticks;
+} ADC_PAIR;
+
+// Comparator internal reference, ACREFCTL VREF with RNG = 0: VDDA * (8 + level) / 32
+#define COMPARATOR_LEVEL_DEFAULT  15
+#define COMPARATOR_LEVELS_MAX     8
+#define CAPTURE_QUEUE_DEPTH       16      // power of two
+
+// Charge transfer: each of the two phases of a cycle lasts at least this long
+#define CHARGE_PHASE_US           1
+
+// Watchdog load for a command that doesn't load its own deadline
+#define WATCHDOG_COMMAND_US       10000000
+
+// One 1 KB flash page kept for data written at run time (sequence.c)
+#define USER_FLASH_WORDS          256
+
+// Comparator trip queued by the interrupt
+typedef struct _CAPTURE_EDGE
+{
+    uint32_t ticks;                 // timer (system clock) since startCapture
+    uint8_t level;                  // reference level it tripped at
+} CAPTURE_EDGE;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initSerialHw();
+
+void setTerminal(uint8_t terminal, bool on);
+void resetOutputTerminals();
+uint8_t getTerminals();             // TERMINAL_* bits currently driven high
+
+// DUT1 (AN11) and DUT2 (AN10), raw 12-bit samples
+int16_t readAdc0Ss3();
+int16_t readAdc1Ss3();
+
+// Back-to-back DUT1/DUT2 pairs sampled at the same instant, as fast as the ADCs convert
+void readAdcBurst(ADC_PAIR *samples, uint16_t count);
+
+// Comparator timing: startCapture stamps the free-running capture timebase,
+// clears the capture value and arms the comparator interrupt, which latches the
+// time since the stamp each time DUT2 rises past the reference. The timebase is
+// never reset, so other timing can run alongside. A capture of 0 means no edge.
+void startCapture();
+void stopCapture();
+uint32_t getCaptureTicks();
+
+// Reference steps for the following captures, lowest first: each trip is queued
+// and moves the reference to the next level, so one charge crosses all of them.
+// No levels (count 0) keeps COMPARATOR_LEVEL_DEFAULT for the whole capture.
+void setComparatorLevels(const uint8_t *levels, uint8_t count);
+bool getCaptureEdge(CAPTURE_EDGE *edge);    // oldest queued trip, false when empty
+uint32_t getCaptureOverflows();
+
+void analogComparator05Isr();
+
+// Charge transfer for capacitors too small to time through HIGHSIDE_R. Each cycle
+// empties the DUT with DUT1 on MEAS_C and DUT2 on LOWSIDE_R, then lifts DUT1 to
+// Vdd on MEAS_LR with DUT2 on INTEGRATE, which moves the DUT's share of the charge
+// into the integrator. Returns the cycles until DUT2 passes the reference level,
+// 0 if it never did in max_cycles. The integrator should start empty; the outputs
+// are off afterwards.
+uint32_t countChargeTransfers(uint8_t level, uint32_t max_cycles);
+
+// The user flash page, memory mapped; writing erases and programs the whole page
+const uint32_t * getUserFlash();
+bool writeUserFlash(const uint32_t *page);
+
+// Time since reset, keeps counting through clock switches and sleep
+uint64_t getUptimeUs();
+
+// Hardware watchdog on the system clock. Loading it restarts the count; the first
+// timeout turns the output terminals off, a second one resets the chip. Idle
+// sleep waiting for the host stops the count.
+void initWatchdog();
+void loadWatchdog(uint32_t us);
+void feedWatchdog();                // restart the count at the last load
+void rearmWatchdog();               // after a first timeout, once its command is torn down
+bool wasWatchdogReset();            // the last reset came from the watchdog
+void watchdogIsr();
+
+// Free-running cycle counter for benchmarks: DWT_CYCCNT on target, the TSC on the host
+void initCycleCounter();
+uint32_t getCycleCount();
+
+// Lowest address of the linker's stack reservation, 0 on the host
+uintptr_t getStackLimit();
+
+// Drive trace timestamps in system clock ticks: the free-running capture timebase
+// on target (counts through sleep, stops in deep sleep), simulated time on the host
+uint32_t getTraceTicks();
+
+#endif /* HAL_H_ */
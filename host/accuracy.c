@@ -0,0 +1,244 @@
+// LCR meter host simulation
+// Accuracy and timing regression: runs the firmware measurement engine against
+// simulated parts across decades and fails when a reading leaves its band
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// accuracy [--clock 40|80] [--noise volts] [--offset volts] [--seed n] [--csv]
+// Exit status is 1 when any case is outside its error band or sim time budget.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "sim_afe.h"
+
+typedef enum _METHOD
+{
+    METHOD_RESISTANCE = 0,
+    METHOD_CAPACITANCE,
+    METHOD_INDUCTANCE,
+    METHOD_ESR,
+    METHOD_SMALL_CAPACITANCE
+} METHOD;
+
+// Nominal in the firmware's units, band is the allowed |error| in percent.
+// Cases expecting another status than OK have no reading to check.
+typedef struct _CASE
+{
+    METHOD method;
+    SIM_DUT dut;
+    double nominal;
+    double band;
+    MEASURE_STATUS status;
+} CASE;
+
+static const char * const methodNames[] = {"resistor", "capacitance", "inductance", "esr", "pf"};
+static const char * const methodUnits[] = {"kohm", "uF", "uH", "ohm", "uF"};
+
+// Simulated duration of each drive sequence in seconds
+static const double methodBudgets[] = {1.97, 30.01, 6.01, 0.1, 0.51};
+
+#define R(ohm, band)          {METHOD_RESISTANCE, {SIM_DUT_RESISTOR, ohm, 0, 0, 0}, (ohm) / 1e3, band, MEASURE_OK}
+#define C(farad, esr, band)   {METHOD_CAPACITANCE, {SIM_DUT_CAPACITOR, 0, 0, farad, esr}, (farad) * 1e6, band, MEASURE_OK}
+#define L(henry, dcr, band)   {METHOD_INDUCTANCE, {SIM_DUT_INDUCTOR, dcr, henry, 0, 0}, (henry) * 1e6, band, MEASURE_OK}
+#define ESR(henry, dcr, band) {METHOD_ESR, {SIM_DUT_INDUCTOR, dcr, henry, 0, 0}, dcr, band, MEASURE_OK}
+#define ESRC(farad, esr, band) {METHOD_ESR, {SIM_DUT_CAPACITOR, 0, 0, farad, esr}, esr, band, MEASURE_OK}
+#define OPEN(method)          {method, {SIM_DUT_OPEN, 0, 0, 0, 0}, 0, 0, MEASURE_OPEN}
+#define SHORT(method)         {method, {SIM_DUT_SHORT, 0, 0, 0, 0}, 0, 0, MEASURE_SHORT}
+#define PF(farad, band)       {METHOD_SMALL_CAPACITANCE, {SIM_DUT_CAPACITOR, 0, 0, farad, 0.1}, (farad) * 1e6, band, MEASURE_OK}
+#define REJECT(method, type, r, l, status) {method, {type, r, l, 0, 0}, 0, 0, status}
+
+// Bands are the error of the shipped conversion tables plus margin. The tables
+// come from this model, so the bands mostly cover tick quantization and the
+// interpolation between breakpoints
+static const CASE cases[] =
+{
+    R(10.0, 5.0),
+    R(100.0, 1.0),
+    R(1e3, 1.0),
+    R(10e3, 1.0),
+    R(100e3, 1.0),
+    R(470e3, 1.0),
+    C(1e-9, 0.1, 1.0),
+    C(10e-9, 0.1, 1.0),
+    C(100e-9, 0.1, 1.0),
+    C(1e-6, 0.1, 1.0),
+    C(10e-6, 0.1, 1.0),
+    C(47e-6, 0.1, 1.0),
+    L(10e-6, 0.05, 5.0),
+    L(100e-6, 0.1, 2.0),
+    L(470e-6, 0.5, 2.0),
+    L(1e-3, 1.0, 2.0),
+    L(10e-3, 5.0, 2.0),
+    ESR(1e-3, 1.0, 1.0),
+    ESR(1e-3, 2.0, 1.0),
+    ESR(1e-3, 4.0, 1.0),
+    ESR(1e-3, 8.0, 1.0),
+    ESRC(10e-6, 1.0, 2.0),
+    ESRC(100e-6, 2.0, 2.0),
+    OPEN(METHOD_RESISTANCE),
+    OPEN(METHOD_CAPACITANCE),
+    OPEN(METHOD_INDUCTANCE),
+    SHORT(METHOD_RESISTANCE),
+    SHORT(METHOD_CAPACITANCE),
+    SHORT(METHOD_INDUCTANCE),
+    REJECT(METHOD_CAPACITANCE, SIM_DUT_RESISTOR, 10e3, 0, MEASURE_SATURATED),
+    REJECT(METHOD_CAPACITANCE, SIM_DUT_RESISTOR, 100e3, 0, MEASURE_SATURATED),
+    REJECT(METHOD_CAPACITANCE, SIM_DUT_RESISTOR, 1e6, 0, MEASURE_SATURATED),
+    PF(10e-12, 1.0),
+    PF(100e-12, 1.0),
+    PF(1e-9, 1.0),
+    OPEN(METHOD_SMALL_CAPACITANCE),
+    REJECT(METHOD_SMALL_CAPACITANCE, SIM_DUT_RESISTOR, 10e3, 0, MEASURE_SATURATED),
+    REJECT(METHOD_SMALL_CAPACITANCE, SIM_DUT_INDUCTOR, 1.0, 1e-3, MEASURE_SATURATED),
+    SHORT(METHOD_SMALL_CAPACITANCE),
+};
+
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// CPU cycles on x86 hosts, nanoseconds elsewhere
+static uint64_t hostCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+static double hostSeconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static MEASUREMENT runMethod(METHOD method)
+{
+    switch (method)
+    {
+        case METHOD_RESISTANCE:
+            return measureResistance();
+        case METHOD_CAPACITANCE:
+            return measureCapacitance();
+        case METHOD_INDUCTANCE:
+            return measureInductance();
+        case METHOD_SMALL_CAPACITANCE:
+            return measureSmallCapacitance();
+        default:
+            return measureEsr();
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: accuracy [--clock 40|80] [--noise volts] [--offset volts] [--seed n] [--csv]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+    bool csv = false;
+    uint32_t failures = 0;
+    double worst[5] = {0};
+    double simTotal = 0, hostTotal = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else if (i + 1 >= argc)
+            usage();
+        else if (strcmp(argv[i], "--clock") == 0)
+            profile = (atoi(argv[++i]) == 80) ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD;
+        else if (strcmp(argv[i], "--noise") == 0)
+            fe.noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "--offset") == 0)
+            fe.comparator_offset = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            fe.seed = strtoul(argv[++i], NULL, 0);
+        else
+            usage();
+    }
+
+    if (csv)
+        printf("method,nominal,unit,measured,error_pct,band_pct,ticks,sim_s,host_us,host_cycles,status\n");
+    else
+        printf("%-12s %12s %-5s %12s %9s %7s %9s %9s %12s  %s\n",
+               "method", "nominal", "unit", "measured", "error%", "band%", "sim s", "host us", "host cycles", "status");
+
+    for (i = 0; i < (int)CASE_COUNT; i++)
+    {
+        const CASE *c = &cases[i];
+        MEASUREMENT m;
+        double simStart, hostStart, simTaken, hostTaken, error;
+        uint64_t cyclesStart, cycles;
+        bool ok;
+
+        simInit(&fe, &c->dut);
+        initClock(profile);
+        initSerialHw();
+
+        simStart = simTime();
+        hostStart = hostSeconds();
+        cyclesStart = hostCycles();
+        m = runMethod(c->method);
+        cycles = hostCycles() - cyclesStart;
+        hostTaken = hostSeconds() - hostStart;
+        simTaken = simTime() - simStart;
+        simTotal += simTaken;
+        hostTotal += hostTaken;
+
+        error = c->status == MEASURE_OK ? 100.0 * (m.value - c->nominal) / c->nominal : 0;
+        ok = m.status == c->status && fabs(error) <= c->band && simTaken <= methodBudgets[c->method] * 1.001;
+        if (!ok)
+            failures++;
+        if (fabs(error) > worst[c->method])
+            worst[c->method] = fabs(error);
+
+        if (csv)
+            printf("%s,%g,%s,%g,%.3f,%g,%u,%.6f,%.1f,%llu,%s\n",
+                   methodNames[c->method], c->nominal, methodUnits[c->method], m.value, error, c->band,
+                   m.ticks, simTaken, hostTaken * 1e6, (unsigned long long)cycles, ok ? "ok" : "FAIL");
+        else
+            printf("%-12s %12g %-5s %12g %9.3f %7g %9.3f %9.1f %12llu  %s%s%s\n",
+                   methodNames[c->method], c->nominal, methodUnits[c->method], m.value, error, c->band,
+                   simTaken, hostTaken * 1e6, (unsigned long long)cycles, ok ? "ok" : "FAIL",
+                   m.status == MEASURE_OK ? "" : " ", m.status == MEASURE_OK ? "" : getMeasureStatusName(m.status));
+    }
+
+    if (!csv)
+    {
+        printf("\nworst error%%: resistor %.3f, capacitance %.3f, inductance %.3f, esr %.3f, pf %.3f\n",
+               worst[METHOD_RESISTANCE], worst[METHOD_CAPACITANCE], worst[METHOD_INDUCTANCE], worst[METHOD_ESR],
+               worst[METHOD_SMALL_CAPACITANCE]);
+        printf("%.1f s simulated in %.3f s host time\n", simTotal, hostTotal);
+        printf("%u of %u cases outside band or budget\n", failures, (uint32_t)CASE_COUNT);
+    }
+    return failures ? 1 : 0;
+}
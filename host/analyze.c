@@ -0,0 +1,439 @@
+// LCR meter host analysis
+// Batch analyzer for raw auto readings: recomputes values with the firmware's
+// conversion, classifies them with the firmware's decision tree and flags outliers
+
+//-----------------------------------------------------------------------------
+// Method
+//-----------------------------------------------------------------------------
+
+// A pool of worker threads takes ANALYZE_CHUNK records at a time off a shared
+// counter. The first pass picks out small capacitors with classifySmallCapacitor
+// and converts their charge transfers with capacitanceFromTransfers; the rest
+// have their ticks converted with lutValue and their probe features classified
+// with classifyVector and componentTree. That is the same code the meter runs,
+// so with the firmware tables the component matches the meter's, and so do the
+// values, except that small capacitors lack the pf fixture zero. Between the
+// passes the main thread takes the median and the median absolute deviation of
+// log10 of each component's own value (resistance of resistors and so on); the
+// second pass flags the readings further than outlier_spread robust standard
+// deviations from that median.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lut.h"
+#include "measure.h"
+#include "analyze.h"
+
+#define ANALYZE_CHUNK       65536
+#define MAD_TO_SIGMA        1.4826  // median absolute deviation to standard deviation, normal data
+#define MIN_SPREAD          0.001   // decades, so identical readings don't make everything else an outlier
+#define MAX_WORKERS         256
+
+typedef struct _POOL
+{
+    const RAW_FILE *files;
+    uint32_t fileCount;
+    const ANALYZE_TABLES *tables;
+    ANALYZE_RESULT *results;
+    size_t total;
+    size_t next;                   // first record of the next chunk, atomic
+    pthread_barrier_t barrier;
+    double median[4];
+    double limit[4];               // decades from the median, 0 skips the component
+} POOL;
+
+// Counts per worker, summed when the pool is done
+typedef struct _WORKER
+{
+    POOL *pool;
+    pthread_t thread;
+    uint64_t bad_check;
+    uint64_t failed;
+    uint64_t reclassified;
+    uint64_t outliers;
+    uint64_t components[4];
+} __attribute__((aligned(64))) WORKER;
+
+_Static_assert(sizeof(RAW_RECORD) == RAW_RECORD_SIZE, "RAW_RECORD layout");
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t getRawRecordCheck(const RAW_RECORD *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint8_t check = RAW_CHECK_SEED;
+    uint8_t i;
+
+    for (i = 0; i < RAW_RECORD_SIZE - 1; i++)
+        check ^= bytes[i];
+    return check;
+}
+
+bool mapRawFile(const char *path, RAW_FILE *file)
+{
+    struct stat st;
+    void *map = NULL;
+    int fd;
+
+    memset(file, 0, sizeof(*file));
+    file->path = path;
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    if (st.st_size >= RAW_RECORD_SIZE)
+    {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            perror(path);
+            close(fd);
+            return false;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    file->records = map;
+    file->count = st.st_size / RAW_RECORD_SIZE;
+    file->trailing = st.st_size % RAW_RECORD_SIZE;
+    return true;
+}
+
+void unmapRawFile(RAW_FILE *file)
+{
+    if (file->records)
+        munmap((void *)file->records, file->count * RAW_RECORD_SIZE + file->trailing);
+    file->records = NULL;
+    file->count = 0;
+}
+
+void getFirmwareTables(ANALYZE_TABLES *tables)
+{
+    tables->resistance = &resistanceLut;
+    tables->capacitance = &capacitanceLut;
+    tables->inductance = &inductanceLut;
+}
+
+// Reads the tables back from a file gen_lut wrote. The scale goes through
+// double to float like the compiler's initializer does.
+bool loadAnalyzeTables(const char *path, ANALYZE_TABLES *tables)
+{
+    static const char * const names[3] = {"resistance", "capacitance", "inductance"};
+    const LUT **slots[3] = {&tables->resistance, &tables->capacitance, &tables->inductance};
+    LUT_POINT *points = NULL;
+    char line[256], name[32];
+    unsigned ticks, value, slope;
+    int declared = 0, count = 0, read = 0, shift, i;
+    double scale;
+    bool found[3] = {false, false, false};
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, " static const LUT_POINT %31[a-z]Points[%d]", name, &declared) == 2)
+        {
+            points = calloc(declared > 0 ? declared : 1, sizeof(LUT_POINT));
+            read = 0;
+        }
+        else if (points && sscanf(line, " {%u, %u, %u}", &ticks, &value, &slope) == 3)
+        {
+            if (read < declared)
+                points[read] = (LUT_POINT){ticks, value, slope};
+            read++;
+        }
+        else if (points && sscanf(line, " const LUT %31[a-z]Lut = {%*[a-zA-Z], %d, %d, %lf}", name, &count, &shift, &scale) == 4)
+        {
+            for (i = 0; i < 3 && strcmp(name, names[i]) != 0; i++)
+                ;
+            if (i == 3 || count != read || count != declared || count < 1 || count > 255 || shift < 0 || shift > 31)
+                break;
+            {
+                LUT *lut = malloc(sizeof(LUT));
+
+                *lut = (LUT){points, count, shift, (float)scale};
+                *slots[i] = lut;
+                found[i] = true;
+                points = NULL;
+            }
+        }
+    }
+    fclose(f);
+    free(points);
+    if (!found[0] || !found[1] || !found[2])
+    {
+        fprintf(stderr, "%s: not a gen_lut table file\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Same classification and conversion as checkAuto on the meter, only the
+// measurement it ran has ticks. A small capacitor went to pf ahead of the tree,
+// its transfers are converted without a fixture zero (pf zero isn't recorded).
+static void analyzeRecord(WORKER *worker, const RAW_RECORD *record, ANALYZE_RESULT *result)
+{
+    const ANALYZE_TABLES *tables = worker->pool->tables;
+    bool small = classifySmallCapacitor(&record->features, record->charged);
+
+    memset(result, 0, sizeof(*result));
+    if (record->check != getRawRecordCheck(record) || record->ticks_per_us == 0)
+    {
+        result->flags = ANALYZE_BAD_CHECK;
+        worker->bad_check++;
+        return;
+    }
+    if (record->inductance_ticks)
+        result->inductance = lutValue(tables->inductance, record->inductance_ticks, record->ticks_per_us, 0);
+    if (record->resistance_ticks)
+        result->resistance = lutValue(tables->resistance, record->resistance_ticks, record->ticks_per_us, 0);
+    if (record->capacitance_ticks && small)
+        result->capacitance = capacitanceFromTransfers(record->capacitance_ticks) * 1e-6f;
+    else if (record->capacitance_ticks)
+        result->capacitance = lutValue(tables->capacitance, record->capacitance_ticks, record->ticks_per_us, 0);
+    if (record->status != MEASURE_OK)
+    {
+        result->flags = ANALYZE_FAILED;
+        worker->failed++;
+        return;
+    }
+    result->component = small ? COMPONENT_CAPACITOR : classifyVector(&componentTree, &record->features);
+    worker->components[result->component]++;
+    if (result->component != record->component)
+    {
+        result->flags |= ANALYZE_RECLASSIFIED;
+        worker->reclassified++;
+    }
+}
+
+static float componentValue(const ANALYZE_RESULT *result)
+{
+    switch (result->component)
+    {
+        case COMPONENT_RESISTOR:
+            return result->resistance;
+        case COMPONENT_CAPACITOR:
+            return result->capacitance;
+        case COMPONENT_INDUCTOR:
+            return result->inductance;
+        default:
+            return 0;
+    }
+}
+
+static void flagOutlier(WORKER *worker, ANALYZE_RESULT *result)
+{
+    const POOL *pool = worker->pool;
+    float value = componentValue(result);
+
+    if (value <= 0 || pool->limit[result->component] <= 0)
+        return;
+    if (fabs(log10(value) - pool->median[result->component]) > pool->limit[result->component])
+    {
+        result->flags |= ANALYZE_OUTLIER;
+        worker->outliers++;
+    }
+}
+
+// Takes chunks until none are left. Chunks are in global record order and may
+// straddle files.
+static void runPass(WORKER *worker, bool classify)
+{
+    POOL *pool = worker->pool;
+    size_t first, index, end, base;
+    uint32_t f;
+
+    while ((first = __atomic_fetch_add(&pool->next, ANALYZE_CHUNK, __ATOMIC_RELAXED)) < pool->total)
+    {
+        end = first + ANALYZE_CHUNK < pool->total ? first + ANALYZE_CHUNK : pool->total;
+        base = 0;
+        for (f = 0; f < pool->fileCount && first < end; f++)
+        {
+            const RAW_FILE *file = &pool->files[f];
+
+            for (index = first; index < end && index < base + file->count; index++)
+            {
+                if (classify)
+                    analyzeRecord(worker, &file->records[index - base], &pool->results[index]);
+                else
+                    flagOutlier(worker, &pool->results[index]);
+            }
+            first = index;
+            base += file->count;
+        }
+    }
+}
+
+static void *runWorker(void *argument)
+{
+    WORKER *worker = argument;
+
+    runPass(worker, true);
+    pthread_barrier_wait(&worker->pool->barrier);
+    pthread_barrier_wait(&worker->pool->barrier);
+    runPass(worker, false);
+    return NULL;
+}
+
+// k-th smallest, reorders values. Three-way partitions so runs of equal
+// readings don't make it quadratic.
+static double selectNth(double *values, size_t count, size_t k)
+{
+    size_t low = 0, high = count, less, greater, i;
+    double pivot, swap;
+
+    for (;;)
+    {
+        pivot = values[low + (high - low) / 2];
+        less = i = low;
+        greater = high;
+        while (i < greater)
+        {
+            if (values[i] < pivot)
+            {
+                swap = values[i];
+                values[i++] = values[less];
+                values[less++] = swap;
+            }
+            else if (values[i] > pivot)
+            {
+                swap = values[i];
+                values[i] = values[--greater];
+                values[greater] = swap;
+            }
+            else
+                i++;
+        }
+        if (k < less)
+            high = less;
+        else if (k >= greater)
+            low = greater;
+        else
+            return pivot;
+    }
+}
+
+static double median(double *values, size_t count)
+{
+    double upper = selectNth(values, count, count / 2);
+
+    if (count % 2)
+        return upper;
+    return (selectNth(values, count, count / 2 - 1) + upper) / 2;
+}
+
+// Median and robust spread of log10 of each component's value
+static bool componentStatistics(POOL *pool, double outlierSpread, ANALYZE_SUMMARY *summary)
+{
+    double *logs = malloc((pool->total ? pool->total : 1) * sizeof(double));
+    size_t count, i;
+    int c;
+
+    if (!logs)
+        return false;
+    for (c = COMPONENT_RESISTOR; c <= COMPONENT_INDUCTOR; c++)
+    {
+        count = 0;
+        for (i = 0; i < pool->total; i++)
+        {
+            const ANALYZE_RESULT *result = &pool->results[i];
+
+            if (result->component == c && componentValue(result) > 0)
+                logs[count++] = log10(componentValue(result));
+        }
+        pool->limit[c] = 0;
+        summary->median[c] = 0;
+        summary->spread[c] = 0;
+        if (count == 0)
+            continue;
+
+        pool->median[c] = median(logs, count);
+        for (i = 0; i < count; i++)
+            logs[i] = fabs(logs[i] - pool->median[c]);
+        summary->median[c] = pow(10.0, pool->median[c]);
+        summary->spread[c] = MAD_TO_SIGMA * median(logs, count);
+        if (outlierSpread > 0)
+            pool->limit[c] = outlierSpread * fmax(summary->spread[c], MIN_SPREAD);
+    }
+    free(logs);
+    return true;
+}
+
+bool analyzeFiles(const RAW_FILE *files, uint32_t fileCount, const ANALYZE_TABLES *tables,
+                  const ANALYZE_OPTIONS *options, ANALYZE_RESULT *results, ANALYZE_SUMMARY *summary)
+{
+    POOL pool;
+    WORKER *workers;
+    uint32_t threads = options->threads, i, c;
+    bool ok;
+
+    memset(&pool, 0, sizeof(pool));
+    pool.files = files;
+    pool.fileCount = fileCount;
+    pool.tables = tables;
+    pool.results = results;
+    for (i = 0; i < fileCount; i++)
+        pool.total += files[i].count;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_WORKERS)
+        threads = MAX_WORKERS;
+    if (posix_memalign((void **)&workers, 64, threads * sizeof(WORKER)) != 0)
+        return false;
+    memset(workers, 0, threads * sizeof(WORKER));
+    pthread_barrier_init(&pool.barrier, NULL, threads + 1);
+    for (i = 0; i < threads; i++)
+    {
+        workers[i].pool = &pool;
+        if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0)
+        {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    // workers run the first pass, then wait for the statistics
+    pthread_barrier_wait(&pool.barrier);
+    memset(summary, 0, sizeof(*summary));
+    ok = componentStatistics(&pool, options->outlier_spread, summary);
+    pool.next = 0;
+    pthread_barrier_wait(&pool.barrier);
+
+    for (i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        summary->bad_check += workers[i].bad_check;
+        summary->failed += workers[i].failed;
+        summary->reclassified += workers[i].reclassified;
+        summary->outliers += workers[i].outliers;
+        for (c = 0; c < 4; c++)
+            summary->components[c] += workers[i].components[c];
+    }
+    summary->records = pool.total;
+    pthread_barrier_destroy(&pool.barrier);
+    free(workers);
+    return ok;
+}
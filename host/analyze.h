@@ -0,0 +1,106 @@
+// LCR meter host analysis
+// Batch analyzer for raw auto readings: recomputes values with the firmware's
+// conversion, classifies them with the firmware's decision tree and flags outliers
+
+#ifndef ANALYZE_H_
+#define ANALYZE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lut.h"
+#include "measure.h"
+#include "classify.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// One auto reading as streamed off the meter, little endian, RAW_RECORD_SIZE
+// bytes. A raw file is these records back to back.
+typedef struct _RAW_RECORD
+{
+    uint32_t sequence;
+    uint32_t timestamp_ms;
+    uint32_t inductance_ticks;     // comparator ticks at ticks_per_us of the one measurement
+    uint32_t resistance_ticks;     // checkAuto ran, 0 for the other two
+    uint32_t capacitance_ticks;    // charge transfers when classifySmallCapacitor
+    CLASSIFY_VECTOR features;      // identifyComponent's probe
+    int16_t charged;               // and its settled high side, for classifySmallCapacitor
+    uint16_t reserved;
+    uint8_t ticks_per_us;          // system clock the ticks were counted at
+    uint8_t status;                // MEASURE_STATUS, checkAuto only classifies MEASURE_OK
+    uint8_t component;             // COMPONENT the meter reported
+    uint8_t check;                 // xor of the other bytes, seeded with RAW_CHECK_SEED
+} RAW_RECORD;
+
+#define RAW_RECORD_SIZE     36
+#define RAW_CHECK_SEED      0xA5
+
+// Result flags
+#define ANALYZE_BAD_CHECK   0x01   // record corrupt, nothing else is filled in
+#define ANALYZE_FAILED      0x02   // status wasn't MEASURE_OK, not classified
+#define ANALYZE_RECLASSIFIED 0x04  // component differs from what the meter reported
+#define ANALYZE_OUTLIER     0x08   // value far from the others of its component
+
+typedef struct _ANALYZE_RESULT
+{
+    float resistance;              // kilo-ohm
+    float capacitance;             // micro-farad
+    float inductance;              // micro-henry
+    uint8_t component;             // COMPONENT
+    uint8_t flags;
+} ANALYZE_RESULT;
+
+// Conversion tables, the firmware's or ones loaded from a gen_lut output file
+typedef struct _ANALYZE_TABLES
+{
+    const LUT *resistance;
+    const LUT *capacitance;
+    const LUT *inductance;
+} ANALYZE_TABLES;
+
+// Memory-mapped raw file
+typedef struct _RAW_FILE
+{
+    const char *path;
+    const RAW_RECORD *records;
+    size_t count;
+    size_t trailing;               // bytes after the last whole record, ignored
+} RAW_FILE;
+
+typedef struct _ANALYZE_OPTIONS
+{
+    uint32_t threads;
+    double outlier_spread;         // robust standard deviations from the median
+} ANALYZE_OPTIONS;
+
+typedef struct _ANALYZE_SUMMARY
+{
+    uint64_t records;
+    uint64_t bad_check;
+    uint64_t failed;
+    uint64_t reclassified;
+    uint64_t outliers;
+    uint64_t components[4];        // by COMPONENT
+    double median[4];              // of the component's own value, firmware unit
+    double spread[4];              // robust standard deviation, decades
+} ANALYZE_SUMMARY;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t getRawRecordCheck(const RAW_RECORD *record);
+
+bool mapRawFile(const char *path, RAW_FILE *file);
+void unmapRawFile(RAW_FILE *file);
+
+void getFirmwareTables(ANALYZE_TABLES *tables);
+bool loadAnalyzeTables(const char *path, ANALYZE_TABLES *tables);
+
+// results holds one entry per record of all the files, in file order
+bool analyzeFiles(const RAW_FILE *files, uint32_t fileCount, const ANALYZE_TABLES *tables,
+                  const ANALYZE_OPTIONS *options, ANALYZE_RESULT *results, ANALYZE_SUMMARY *summary);
+
+#endif /* ANALYZE_H_ */
@@ -0,0 +1,284 @@
+// LCR meter host analysis
+// Batch analyzer command line: memory-maps raw auto reading files, analyzes them
+// on a thread pool and prints a summary, or records raw files from the simulation
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// analyze [--threads n] [--lut lut_data.c] [--outlier sigma] [--csv out.csv] [--all] file...
+// analyze --record n [--clock 40|80] [--seed n] file
+// Files are RAW_RECORDs (analyze.h) back to back. --lut recomputes with tables
+// gen_lut wrote instead of the firmware's, e.g. after "gen_lut --cal new.csv -o
+// new_lut.c". The CSV lists the flagged readings, --all every reading. --record
+// runs checkAuto's phases on the simulated meter against parts drawn across the
+// accuracy decades and writes what the meter would stream.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "sim_afe.h"
+#include "analyze.h"
+
+static const char * const componentNames[4] = {"unknown", "resistor", "capacitor", "inductor"};
+static const char * const componentUnits[4] = {"", "kilo-ohm", "micro-farad", "micro-henry"};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: analyze [--threads n] [--lut lut_data.c] [--outlier sigma] [--csv out.csv] [--all] file...\n"
+                    "       analyze --record n [--clock 40|80] [--seed n] file\n");
+    exit(2);
+}
+
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// xorshift32
+static double uniform(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state >> 8) * (1.0 / 16777216.0);
+}
+
+// Log-uniform over the decades accuracy checks, parasitics as gen_lut's model parts
+static SIM_DUT drawPart(uint32_t *random)
+{
+    SIM_DUT part = {SIM_DUT_RESISTOR, 0, 0, 0, 0};
+    double decades = uniform(random);
+
+    switch ((int)(uniform(random) * 3))
+    {
+        case 0:
+            part.r = 10.0 * pow(10.0, 5 * decades);
+            break;
+        case 1:
+            part.type = SIM_DUT_CAPACITOR;
+            part.c = 10e-12 * pow(10.0, 7 * decades);
+            part.esr = 0.1;
+            break;
+        default:
+            part.type = SIM_DUT_INDUCTOR;
+            part.l = 10e-6 * pow(10.0, 4 * decades);
+            part.r = 0.05 * pow(part.l / 10e-6, 2.0 / 3.0);
+            break;
+    }
+    return part;
+}
+
+// One checkAuto on the simulated meter: the probe, then the measurement of the
+// component it identified
+static RAW_RECORD recordAuto(uint32_t sequence, CLOCK_PROFILE profile, uint32_t *random, double *elapsed)
+{
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT part = drawPart(random);
+    RAW_RECORD record;
+    MEASUREMENT measurement = {0};
+    COMPONENT component;
+
+    fe.seed = *random;
+    simInit(&fe, &part);
+    initClock(profile);
+    initSerialHw();
+
+    memset(&record, 0, sizeof(record));
+    record.status = identifyComponent(&component, &record.features, &record.charged);
+    record.component = component;
+    if (component == COMPONENT_RESISTOR)
+    {
+        measurement = measureResistance();
+        record.resistance_ticks = measurement.ticks;
+    }
+    else if (component == COMPONENT_CAPACITOR)
+    {
+        measurement = wasSmallCapacitor() ? measureSmallCapacitance() : measureCapacitance();
+        record.capacitance_ticks = measurement.ticks;
+    }
+    else if (component == COMPONENT_INDUCTOR)
+    {
+        measurement = measureInductance();
+        record.inductance_ticks = measurement.ticks;
+    }
+    if (record.status == MEASURE_OK)
+        record.status = measurement.status;
+    *elapsed += simTime();
+
+    record.sequence = sequence;
+    record.timestamp_ms = (uint32_t)(*elapsed * 1000.0);
+    record.ticks_per_us = getTicksPerUs();
+    record.check = getRawRecordCheck(&record);
+    return record;
+}
+
+static int recordFile(const char *path, uint32_t count, CLOCK_PROFILE profile, uint32_t seed)
+{
+    FILE *f = fopen(path, "wb");
+    uint32_t random = seed ? seed : 1;
+    double elapsed = 0, started = seconds();
+    uint32_t i;
+
+    if (!f)
+    {
+        perror(path);
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        RAW_RECORD record = recordAuto(i, profile, &random, &elapsed);
+
+        if (fwrite(&record, RAW_RECORD_SIZE, 1, f) != 1)
+        {
+            perror(path);
+            fclose(f);
+            return 1;
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "analyze: %u readings recorded, %.1f s simulated in %.3f s host time\n",
+            count, elapsed, seconds() - started);
+    return 0;
+}
+
+static bool writeCsv(const char *path, const RAW_FILE *files, uint32_t fileCount,
+                     const ANALYZE_RESULT *results, bool all)
+{
+    FILE *f = fopen(path, "w");
+    size_t index = 0, i;
+    uint32_t n;
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "file,sequence,timestamp_ms,component,resistance,capacitance,inductance,flags\n");
+    for (n = 0; n < fileCount; n++)
+    {
+        for (i = 0; i < files[n].count; i++, index++)
+        {
+            const RAW_RECORD *record = &files[n].records[i];
+            const ANALYZE_RESULT *result = &results[index];
+
+            if (!all && result->flags == 0)
+                continue;
+            fprintf(f, "%s,%u,%u,%s,%.9g,%.9g,%.9g,0x%02x\n", files[n].path, record->sequence,
+                    record->timestamp_ms, componentNames[result->component], result->resistance,
+                    result->capacitance, result->inductance, result->flags);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    ANALYZE_OPTIONS options = {sysconf(_SC_NPROCESSORS_ONLN), 5.0};
+    ANALYZE_TABLES tables;
+    ANALYZE_SUMMARY summary;
+    ANALYZE_RESULT *results;
+    RAW_FILE *files;
+    CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+    const char *lut = NULL, *csv = NULL;
+    uint32_t record = 0, seed = 1, fileCount = 0, i;
+    size_t total = 0;
+    bool all = false;
+    double started, elapsed;
+    int c;
+
+    files = calloc(argc, sizeof(RAW_FILE));
+    if (!files)
+        return 1;
+    for (c = 1; c < argc; c++)
+    {
+        bool value = c + 1 < argc;
+
+        if (strcmp(argv[c], "--threads") == 0 && value)
+            options.threads = atoi(argv[++c]);
+        else if (strcmp(argv[c], "--lut") == 0 && value)
+            lut = argv[++c];
+        else if (strcmp(argv[c], "--outlier") == 0 && value)
+            options.outlier_spread = atof(argv[++c]);
+        else if (strcmp(argv[c], "--csv") == 0 && value)
+            csv = argv[++c];
+        else if (strcmp(argv[c], "--all") == 0)
+            all = true;
+        else if (strcmp(argv[c], "--record") == 0 && value)
+            record = strtoul(argv[++c], NULL, 0);
+        else if (strcmp(argv[c], "--clock") == 0 && value)
+            profile = (atoi(argv[++c]) == 80) ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD;
+        else if (strcmp(argv[c], "--seed") == 0 && value)
+            seed = strtoul(argv[++c], NULL, 0);
+        else if (argv[c][0] == '-')
+            usage();
+        else
+            files[fileCount++].path = argv[c];
+    }
+    if (fileCount == 0 || options.threads < 1)
+        usage();
+
+    if (record)
+    {
+        if (fileCount != 1)
+            usage();
+        return recordFile(files[0].path, record, profile, seed);
+    }
+
+    getFirmwareTables(&tables);
+    if (lut && !loadAnalyzeTables(lut, &tables))
+        return 1;
+    for (i = 0; i < fileCount; i++)
+    {
+        if (!mapRawFile(files[i].path, &files[i]))
+            return 1;
+        if (files[i].trailing)
+            fprintf(stderr, "analyze: %s: %zu trailing bytes ignored\n", files[i].path, files[i].trailing);
+        total += files[i].count;
+    }
+    results = malloc((total ? total : 1) * sizeof(ANALYZE_RESULT));
+    if (!results)
+        return 1;
+
+    started = seconds();
+    if (!analyzeFiles(files, fileCount, &tables, &options, results, &summary))
+        return 1;
+    elapsed = seconds() - started;
+
+    printf("%zu readings in %u files, %u threads, %.3f s, %.2f M readings/s\n", total, fileCount,
+           options.threads, elapsed, elapsed > 0 ? total / elapsed * 1e-6 : 0);
+    printf("tables: %s\n", lut ? lut : "firmware");
+    for (c = COMPONENT_RESISTOR; c <= COMPONENT_INDUCTOR; c++)
+        printf("%-9s %10llu  median %.6g %s, spread %.4f decades\n", componentNames[c],
+               (unsigned long long)summary.components[c], summary.median[c], componentUnits[c], summary.spread[c]);
+    printf("%-9s %10llu\n", componentNames[COMPONENT_UNKNOWN], (unsigned long long)summary.components[COMPONENT_UNKNOWN]);
+    printf("bad check %llu, failed %llu, reclassified %llu, outliers %llu\n",
+           (unsigned long long)summary.bad_check, (unsigned long long)summary.failed,
+           (unsigned long long)summary.reclassified, (unsigned long long)summary.outliers);
+
+    if (csv && !writeCsv(csv, files, fileCount, results, all))
+        return 1;
+    for (i = 0; i < fileCount; i++)
+        unmapRawFile(&files[i]);
+    free(results);
+    free(files);
+    return 0;
+}
@@ -0,0 +1,49 @@
+// LCR meter host simulation
+// Runs the firmware microbenchmarks on the host, same report as the bench command
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// bench [--clock 40|80] > report.csv
+// Cycles are host TSC cycles, diff reports from the same machine only.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock.h"
+#include "bench.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Report lines without the carriage returns the UART terminal needs
+static void printReport(char *str)
+{
+    for (; *str; str++)
+        if (*str != '\r')
+            putchar(*str);
+}
+
+int main(int argc, char *argv[])
+{
+    CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+
+    if (argc == 3 && strcmp(argv[1], "--clock") == 0)
+        profile = (atoi(argv[2]) == 80) ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD;
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: bench [--clock 40|80]\n");
+        return 2;
+    }
+
+    initClock(profile);
+    runBenchmarks(printReport);
+    return 0;
+}
@@ -0,0 +1,453 @@
+// LCR meter host simulation
+// Component classifier generator: probes labeled parts through identifyComponent
+// (measure.c), trains a decision tree on the probe features and writes it out
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// gen_classifier [--parts n] [--depth n] [--min-leaf n] [--captures list.csv] [--seed n] [-o classify_data.c]
+// Simulated parts are drawn log-uniformly across the measurable decades of each
+// kind, shorts are labeled unknown, each on a front end with random noise and
+// comparator offset. Capture lines are "label,path" with label resistor|capacitor|
+// inductor|unknown and path a "record dump" of an auto command on the meter; the
+// recorded probe is replayed for its features. One part in five is held out and
+// the tree's accuracy on those is printed per label.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "classify.h"
+#include "sim_afe.h"
+#include "sim_replay.h"
+
+#define LABELS          4          // COMPONENT
+#define MAX_NODES       255        // CLASSIFY_NODE right is 8 bits
+#define HOLD_OUT        5          // every fifth part is a test part
+
+typedef struct _EXAMPLE
+{
+    CLASSIFY_VECTOR features;
+    uint8_t label;
+    bool test;
+} EXAMPLE;
+
+static const char *labelNames[LABELS] = {"unknown", "resistor", "capacitor", "inductor"};
+static const char *featureNames[CLASSIFY_FEATURES] =
+{
+    "CLASSIFY_HIGHSIDE", "CLASSIFY_STEP", "CLASSIFY_LOWSIDE", "CLASSIFY_SLOPE"
+};
+
+static EXAMPLE *examples = NULL;
+static uint32_t exampleCount = 0;
+static uint32_t exampleSize = 0;
+
+static CLASSIFY_NODE nodes[MAX_NODES];
+static uint8_t nodeCount = 0;
+static int maxDepth = 6;
+static uint32_t minLeaf = 8;
+
+// xorshift32, the seed must not be 0
+static uint32_t seedState = 1;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: gen_classifier [--parts n] [--depth n] [--min-leaf n] [--captures list.csv] [--seed n] [-o classify_data.c]\n");
+    exit(2);
+}
+
+static double uniform(void)
+{
+    seedState ^= seedState << 13;
+    seedState ^= seedState >> 17;
+    seedState ^= seedState << 5;
+    return (seedState >> 8) / 16777216.0;
+}
+
+static double logUniform(double first, double last)
+{
+    return first * pow(last / first, uniform());
+}
+
+static void addExample(const CLASSIFY_VECTOR *features, uint8_t label)
+{
+    if (exampleCount == exampleSize)
+    {
+        exampleSize = exampleSize ? exampleSize * 2 : 1024;
+        examples = realloc(examples, exampleSize * sizeof(EXAMPLE));
+        if (!examples)
+        {
+            perror("gen_classifier");
+            exit(1);
+        }
+    }
+    examples[exampleCount].features = *features;
+    examples[exampleCount].label = label;
+    examples[exampleCount].test = exampleCount % HOLD_OUT == HOLD_OUT - 1;
+    exampleCount++;
+}
+
+// Typical parasitics as in gen_lut, the same ranges as the accuracy cases
+static SIM_DUT drawPart(uint8_t label)
+{
+    SIM_DUT part = {SIM_DUT_SHORT, 0, 0, 0, 0};
+
+    switch (label)
+    {
+        case COMPONENT_RESISTOR:
+            part.type = SIM_DUT_RESISTOR;
+            part.r = logUniform(10, 1e6);
+            break;
+        case COMPONENT_CAPACITOR:
+            part.type = SIM_DUT_CAPACITOR;
+            part.c = logUniform(1e-9, 100e-6);
+            part.esr = logUniform(0.05, 2);
+            break;
+        case COMPONENT_INDUCTOR:
+            part.type = SIM_DUT_INDUCTOR;
+            part.l = logUniform(10e-6, 100e-3);
+            part.r = 0.05 * pow(part.l / 10e-6, 2.0 / 3.0) * logUniform(0.5, 2);
+            break;
+        default:
+            part.type = SIM_DUT_RESISTOR;
+            part.r = logUniform(0.01, 1);
+            break;
+    }
+    return part;
+}
+
+static void probeParts(uint32_t parts)
+{
+    SIM_FRONT_END fe;
+    SIM_DUT part;
+    CLASSIFY_VECTOR features;
+    COMPONENT component;
+    int16_t charged;
+    uint32_t i;
+    uint8_t label;
+
+    for (i = 0; i < parts * LABELS; i++)
+    {
+        label = i % LABELS;
+        part = drawPart(label);
+        fe = simDefaultFrontEnd();
+        fe.noise = uniform() * 0.005;
+        fe.comparator_offset = (uniform() - 0.5) * 0.004;
+        fe.seed = seedState;
+        simInit(&fe, &part);
+        initClock(CLOCK_PROFILE_STANDARD);
+        initSerialHw();
+        if (identifyComponent(&component, &features, &charged) == MEASURE_OK)
+            addExample(&features, label);
+    }
+}
+
+static int labelFromName(const char *name)
+{
+    int i;
+
+    for (i = 0; i < LABELS; i++)
+        if (strcmp(name, labelNames[i]) == 0)
+            return i;
+    return -1;
+}
+
+static void probeCaptures(const char *path)
+{
+    char line[256];
+    char name[32], capture[200];
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT open = {SIM_DUT_OPEN, 0, 0, 0, 0};
+    CLASSIFY_VECTOR features;
+    COMPONENT component;
+    int16_t charged;
+    MEASURE_STATUS status;
+    uint32_t used = 0;
+    int label;
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] == '#' || sscanf(line, "%31[^,],%199[^\r\n]", name, capture) != 2)
+            continue;
+        label = labelFromName(name);
+        if (label < 0)
+        {
+            fprintf(stderr, "gen_classifier: %s: no label %s\n", path, name);
+            exit(1);
+        }
+        if (!simReplayLoad(capture))
+            exit(1);
+        simInit(&fe, &open);
+        initClock(simReplayTicksPerUs() == 80 ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD);
+        initSerialHw();
+        status = identifyComponent(&component, &features, &charged);
+        simReplayStop();
+        if (status == MEASURE_OK)
+        {
+            addExample(&features, label);
+            used++;
+        }
+        else
+            fprintf(stderr, "gen_classifier: %s: no probe in the recording\n", capture);
+    }
+    fclose(f);
+    fprintf(stderr, "gen_classifier: %u captures from %s\n", used, path);
+}
+
+static double gini(const uint32_t counts[LABELS], uint32_t total)
+{
+    double sum = 1;
+    int i;
+
+    for (i = 0; i < LABELS; i++)
+        sum -= ((double)counts[i] / total) * ((double)counts[i] / total);
+    return sum;
+}
+
+static uint8_t majority(const uint32_t counts[LABELS])
+{
+    uint8_t best = 0;
+    int i;
+
+    for (i = 1; i < LABELS; i++)
+        if (counts[i] > counts[best])
+            best = i;
+    return best;
+}
+
+static int sortFeature;
+
+static int compareExamples(const void *a, const void *b)
+{
+    const EXAMPLE * const *x = a;
+    const EXAMPLE * const *y = b;
+
+    return (*x)->features.value[sortFeature] - (*y)->features.value[sortFeature];
+}
+
+static uint8_t addNode(int16_t threshold, uint8_t feature)
+{
+    if (nodeCount == MAX_NODES)
+    {
+        fprintf(stderr, "gen_classifier: more than %d nodes, lower --depth\n", MAX_NODES);
+        exit(1);
+    }
+    nodes[nodeCount].threshold = threshold;
+    nodes[nodeCount].feature = feature;
+    nodes[nodeCount].right = 0;
+    return nodeCount++;
+}
+
+// CART: the split with the least weighted Gini impurity, the threshold halfway
+// between the two feature values it falls between. Nodes go out in preorder.
+static void growTree(const EXAMPLE **set, uint32_t count, int depth)
+{
+    uint32_t counts[LABELS] = {0}, left[LABELS], right[LABELS];
+    double best, impurity;
+    int16_t threshold = 0;
+    int feature, bestFeature = -1;
+    uint32_t i, split = 0;
+    uint8_t node;
+
+    for (i = 0; i < count; i++)
+        counts[set[i]->label]++;
+    best = gini(counts, count);
+    if (depth < maxDepth && best > 0 && count >= 2 * minLeaf)
+    {
+        for (feature = 0; feature < CLASSIFY_FEATURES; feature++)
+        {
+            sortFeature = feature;
+            qsort(set, count, sizeof(set[0]), compareExamples);
+            memset(left, 0, sizeof(left));
+            memcpy(right, counts, sizeof(right));
+            for (i = 0; i + 1 < count; i++)
+            {
+                left[set[i]->label]++;
+                right[set[i]->label]--;
+                if (i + 1 < minLeaf || count - i - 1 < minLeaf)
+                    continue;
+                if (set[i]->features.value[feature] == set[i + 1]->features.value[feature])
+                    continue;
+                impurity = (gini(left, i + 1) * (i + 1) + gini(right, count - i - 1) * (count - i - 1)) / count;
+                if (impurity < best - 1e-9)
+                {
+                    best = impurity;
+                    bestFeature = feature;
+                    split = i + 1;
+                    threshold = (set[i]->features.value[feature] + set[i + 1]->features.value[feature]) / 2;
+                }
+            }
+        }
+    }
+    if (bestFeature < 0)
+    {
+        addNode(majority(counts), CLASSIFY_LEAF);
+        return;
+    }
+
+    sortFeature = bestFeature;
+    qsort(set, count, sizeof(set[0]), compareExamples);
+    node = addNode(threshold, bestFeature);
+    growTree(set, split, depth + 1);
+    nodes[node].right = nodeCount;
+    growTree(set + split, count - split, depth + 1);
+}
+
+// Splits whose two sides are the same leaf are folded into it
+static void pruneTree(void)
+{
+    CLASSIFY_NODE pruned[MAX_NODES];
+    uint8_t count;
+    bool changed = true;
+    int i;
+
+    while (changed)
+    {
+        changed = false;
+        for (i = 0; i + 2 < nodeCount; i++)
+        {
+            if (nodes[i].feature == CLASSIFY_LEAF || nodes[i + 1].feature != CLASSIFY_LEAF || nodes[i].right != i + 2)
+                continue;
+            if (nodes[i + 2].feature != CLASSIFY_LEAF || nodes[i + 1].threshold != nodes[i + 2].threshold)
+                continue;
+            memcpy(pruned, nodes, sizeof(nodes));
+            for (count = 0; count < nodeCount; count++)
+                if (pruned[count].feature != CLASSIFY_LEAF && pruned[count].right > i)
+                    pruned[count].right -= 2;
+            pruned[i] = nodes[i + 1];
+            memmove(&pruned[i + 1], &pruned[i + 3], (nodeCount - i - 3) * sizeof(CLASSIFY_NODE));
+            nodeCount -= 2;
+            memcpy(nodes, pruned, nodeCount * sizeof(CLASSIFY_NODE));
+            changed = true;
+            break;
+        }
+    }
+}
+
+// Percent of the held out (or training) parts the tree gets right, per label
+static double score(const CLASSIFY_TREE *tree, bool test, bool print)
+{
+    uint32_t right[LABELS] = {0}, total[LABELS] = {0};
+    uint32_t i, sumRight = 0, sumTotal = 0;
+    uint8_t label;
+
+    for (i = 0; i < exampleCount; i++)
+    {
+        if (examples[i].test != test)
+            continue;
+        label = examples[i].label;
+        total[label]++;
+        if (classifyVector(tree, &examples[i].features) == label)
+            right[label]++;
+    }
+    for (i = 0; i < LABELS; i++)
+    {
+        sumRight += right[i];
+        sumTotal += total[i];
+        if (print && total[i])
+            fprintf(stderr, "gen_classifier: %-9s %5u of %5u (%.1f %%)\n", labelNames[i], right[i], total[i], 100.0 * right[i] / total[i]);
+    }
+    return sumTotal ? 100.0 * sumRight / sumTotal : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = "classify_data.c";
+    const char *captures = NULL;
+    const EXAMPLE **set;
+    CLASSIFY_TREE tree = {nodes, 0};
+    uint32_t parts = 1000, trainCount = 0;
+    double trained, tested;
+    char feature[24];
+    FILE *f;
+    uint32_t i;
+
+    for (i = 1; i < (uint32_t)argc; i++)
+    {
+        if (i + 1 >= (uint32_t)argc)
+            usage();
+        else if (strcmp(argv[i], "--parts") == 0)
+            parts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0)
+            maxDepth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-leaf") == 0)
+            minLeaf = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--captures") == 0)
+            captures = argv[++i];
+        else if (strcmp(argv[i], "--seed") == 0)
+            seedState = strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[++i];
+        else
+            usage();
+    }
+    if (parts < 1 || maxDepth < 1 || minLeaf < 1 || seedState == 0)
+        usage();
+
+    probeParts(parts);
+    if (captures)
+        probeCaptures(captures);
+
+    set = malloc(exampleCount * sizeof(set[0]));
+    if (!set)
+    {
+        perror("gen_classifier");
+        return 1;
+    }
+    for (i = 0; i < exampleCount; i++)
+        if (!examples[i].test)
+            set[trainCount++] = &examples[i];
+    growTree(set, trainCount, 0);
+    pruneTree();
+    free(set);
+
+    tree.count = nodeCount;
+    trained = score(&tree, false, false);
+    fprintf(stderr, "gen_classifier: %u nodes, %.1f %% of %u training parts, held out:\n", nodeCount, trained, trainCount);
+    tested = score(&tree, true, true);
+
+    f = fopen(output, "w");
+    if (!f)
+    {
+        perror(output);
+        return 1;
+    }
+    fprintf(f, "// LCR meter component classifier\n");
+    fprintf(f, "// Generated by host/gen_classifier (%u parts, depth %d, %.1f %% held out correct%s%s), do not edit\n",
+            exampleCount, maxDepth, tested, captures ? ", captures " : "", captures ? captures : "");
+    fprintf(f, "\n#include <stdint.h>\n#include <stdbool.h>\n#include \"classify.h\"\n");
+    fprintf(f, "\n// {threshold, feature, right}, features in Q15 of Vin, leaves hold the COMPONENT\n");
+    fprintf(f, "static const CLASSIFY_NODE componentNodes[%u] =\n{\n", nodeCount);
+    for (i = 0; i < nodeCount; i++)
+    {
+        if (nodes[i].feature == CLASSIFY_LEAF)
+        {
+            fprintf(f, "    {%6d, %-19s %3u},   // %s\n", nodes[i].threshold, "CLASSIFY_LEAF,", 0, labelNames[nodes[i].threshold]);
+            continue;
+        }
+        snprintf(feature, sizeof(feature), "%s,", featureNames[nodes[i].feature]);
+        fprintf(f, "    {%6d, %-19s %3u},\n", nodes[i].threshold, feature, nodes[i].right);
+    }
+    fprintf(f, "};\n\nconst CLASSIFY_TREE componentTree = {componentNodes, %u};\n", nodeCount);
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,301 @@
+// LCR meter host simulation
+// Conversion table generator: runs the firmware drive sequences against the
+// simulated front end across decades and writes the tick to value tables
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// gen_lut [--cal file.csv] [--per-decade n] [-o lut_data.c]
+// Calibration lines are "method,value,ticks" with method resistor|capacitance|inductance,
+// value in the firmware's unit (kilo-ohm, micro-farad, micro-henry) and ticks at
+// LUT_TICKS_PER_US, counted as the meter counts them (truncated). Tables are indexed
+// by the middle of a tick, where lutValue puts a count. Where a method has calibration points they replace the model
+// between the smallest and largest calibrated tick count.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "lut.h"
+#include "sim_afe.h"
+
+#define MAX_POINTS      255
+#define MAX_SLOPE_SHIFT 24
+
+typedef struct _SAMPLE
+{
+    double ticks;
+    double value;                  // table units
+    bool calibrated;
+} SAMPLE;
+
+typedef struct _TABLE
+{
+    const char *name;              // lut_data.c symbol prefix
+    const char *method;            // --cal method name
+    const char *unit;              // table units, for the comment
+    double first;                  // sweep, SI units
+    double last;
+    double to_table;               // SI to table units
+    double from_firmware;          // firmware unit to table units
+    SAMPLE samples[MAX_POINTS];
+    int count;
+} TABLE;
+
+static TABLE tables[] =
+{
+    {"resistance", "resistor", "milli-ohm", 1.0, 1e6, 1e3, 1e6},
+    {"capacitance", "capacitance", "pico-farad", 10e-12, 100e-6, 1e12, 1e6},
+    {"inductance", "inductance", "nano-henry", 1e-6, 100e-3, 1e9, 1e3},
+};
+
+#define TABLES (sizeof(tables) / sizeof(tables[0]))
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: gen_lut [--cal file.csv] [--per-decade n] [-o lut_data.c]\n");
+    exit(2);
+}
+
+// Typical parasitics, the same order as the accuracy cases
+static SIM_DUT modelPart(int table, double value)
+{
+    SIM_DUT part = {SIM_DUT_RESISTOR, value, 0, 0, 0};
+
+    if (table == 1)
+    {
+        part.type = SIM_DUT_CAPACITOR;
+        part.r = 0;
+        part.c = value;
+        part.esr = 0.1;
+    }
+    else if (table == 2)
+    {
+        part.type = SIM_DUT_INDUCTOR;
+        part.l = value;
+        part.r = 0.05 * pow(value / 10e-6, 2.0 / 3.0);   // winding resistance
+    }
+    return part;
+}
+
+// Counted at 80 MHz for the finer tick, then placed mid-tick at the table rate
+static double modelTicks(int table, double value)
+{
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT part = modelPart(table, value);
+    MEASUREMENT m;
+
+    simInit(&fe, &part);
+    initClock(CLOCK_PROFILE_TURBO);
+    initSerialHw();
+    if (table == 0)
+        m = measureResistance();
+    else if (table == 1)
+        m = measureCapacitance();
+    else
+        m = measureInductance();
+    if (m.ticks == 0)
+        return 0;
+    return (m.ticks + 0.5) * LUT_TICKS_PER_US / getTicksPerUs();
+}
+
+static void addSample(TABLE *t, double ticks, double value, bool calibrated)
+{
+    if (t->count >= MAX_POINTS)
+    {
+        fprintf(stderr, "gen_lut: %s table full\n", t->name);
+        exit(1);
+    }
+    t->samples[t->count].ticks = ticks;
+    t->samples[t->count].value = value;
+    t->samples[t->count].calibrated = calibrated;
+    t->count++;
+}
+
+static void readCalibration(const char *path)
+{
+    char line[128];
+    char method[32];
+    double value, ticks;
+    FILE *f = fopen(path, "r");
+    unsigned i;
+
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] == '#' || sscanf(line, "%31[^,],%lf,%lf", method, &value, &ticks) != 3)
+            continue;
+        for (i = 0; i < TABLES; i++)
+            if (strcmp(method, tables[i].method) == 0)
+                addSample(&tables[i], ticks + 0.5, value * tables[i].from_firmware, true);
+    }
+    fclose(f);
+}
+
+static void sweepModel(TABLE *t, int table, int per_decade)
+{
+    double calFirst = INFINITY, calLast = -INFINITY;
+    double value;
+    double ticks;
+    int i, n;
+
+    for (i = 0; i < t->count; i++)
+    {
+        calFirst = fmin(calFirst, t->samples[i].ticks);
+        calLast = fmax(calLast, t->samples[i].ticks);
+    }
+
+    n = (int)lround(log10(t->last / t->first) * per_decade);
+    for (i = 0; i <= n; i++)
+    {
+        value = t->first * pow(10.0, (double)i / per_decade);
+        ticks = modelTicks(table, value);
+        if (ticks >= calFirst && ticks <= calLast)
+            continue;
+        addSample(t, ticks, value * t->to_table, false);
+    }
+}
+
+static int bySampleTicks(const void *a, const void *b)
+{
+    const SAMPLE *x = a, *y = b;
+
+    if (x->ticks != y->ticks)
+        return x->ticks < y->ticks ? -1 : 1;
+    return y->calibrated - x->calibrated;
+}
+
+// Sorted by ticks, keeping only points that raise both ticks and value. Parts
+// whose edge never came (ticks 0 or the window's end) drop out here.
+static void monotonic(TABLE *t)
+{
+    int i, kept = 0;
+
+    qsort(t->samples, t->count, sizeof(SAMPLE), bySampleTicks);
+    for (i = 0; i < t->count; i++)
+    {
+        if (t->samples[i].ticks < 1 || t->samples[i].value > 4294967295.0)
+            continue;
+        if (kept > 0 && (t->samples[i].ticks <= t->samples[kept - 1].ticks ||
+                         t->samples[i].value <= t->samples[kept - 1].value))
+            continue;
+        t->samples[kept++] = t->samples[i];
+    }
+    t->count = kept;
+    if (t->count < 2)
+    {
+        fprintf(stderr, "gen_lut: %s table needs at least two points\n", t->name);
+        exit(1);
+    }
+}
+
+static double segmentSlope(const TABLE *t, int i)
+{
+    if (i >= t->count - 1)
+        i = t->count - 2;
+    return (t->samples[i + 1].value - t->samples[i].value) / (t->samples[i + 1].ticks - t->samples[i].ticks);
+}
+
+// Most fraction bits that still fit every slope in 32 bits, never fewer than the
+// tick fraction lutValue interpolates with
+static int slopeShift(const TABLE *t)
+{
+    double steepest = 0;
+    int i, shift;
+
+    for (i = 0; i < t->count; i++)
+        steepest = fmax(steepest, segmentSlope(t, i));
+    for (shift = MAX_SLOPE_SHIFT; shift > LUT_FRACTION_BITS; shift--)
+        if (ldexp(steepest, shift) < 4294967295.0)
+            break;
+    return shift;
+}
+
+// Breakpoints on whole ticks, each value moved along its segment to the rounded tick
+static void writeTable(FILE *f, const TABLE *t)
+{
+    int shift = slopeShift(t);
+    double ticks;
+    int i;
+
+    fprintf(f, "\n// %s in %s\n", t->name, t->unit);
+    fprintf(f, "static const LUT_POINT %sPoints[%d] =\n{\n", t->name, t->count);
+    for (i = 0; i < t->count; i++)
+    {
+        ticks = round(t->samples[i].ticks);
+        fprintf(f, "    {%10u, %10u, %10u},%s\n",
+                (uint32_t)ticks,
+                (uint32_t)lround(t->samples[i].value + segmentSlope(t, i) * (ticks - t->samples[i].ticks)),
+                (uint32_t)lround(ldexp(segmentSlope(t, i), shift)),
+                t->samples[i].calibrated ? "   // calibrated" : "");
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "const LUT %sLut = {%sPoints, %d, %d, %.9g};\n",
+            t->name, t->name, t->count, shift, 1.0 / t->from_firmware);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = "../lut_data.c";
+    const char *calibration = NULL;
+    int perDecade = 8;
+    unsigned i;
+    FILE *f;
+
+    for (i = 1; i < (unsigned)argc; i++)
+    {
+        if (i + 1 >= (unsigned)argc)
+            usage();
+        else if (strcmp(argv[i], "--cal") == 0)
+            calibration = argv[++i];
+        else if (strcmp(argv[i], "--per-decade") == 0)
+            perDecade = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[++i];
+        else
+            usage();
+    }
+    if (perDecade < 1)
+        usage();
+
+    if (calibration)
+        readCalibration(calibration);
+    for (i = 0; i < TABLES; i++)
+    {
+        sweepModel(&tables[i], i, perDecade);
+        monotonic(&tables[i]);
+    }
+
+    f = fopen(output, "w");
+    if (!f)
+    {
+        perror(output);
+        return 1;
+    }
+    fprintf(f, "// LCR meter conversion tables\n");
+    fprintf(f, "// Generated by host/gen_lut (%d points per decade%s%s), do not edit\n",
+            perDecade, calibration ? ", calibration " : "", calibration ? calibration : "");
+    fprintf(f, "\n#include <stdint.h>\n#include <stdbool.h>\n#include \"lut.h\"\n");
+    fprintf(f, "\n// {ticks at %d MHz, value, slope}\n", LUT_TICKS_PER_US);
+    for (i = 0; i < TABLES; i++)
+        writeTable(f, &tables[i]);
+    fclose(f);
+    return 0;
+}
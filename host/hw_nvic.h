@@ -0,0 +1,2 @@
+// LCR meter host simulation
+// Stand-in for the TivaWare header, nothing in it is used on the host
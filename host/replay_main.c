@@ -0,0 +1,104 @@
+// LCR meter host simulation
+// Replays a meter recording: the recorded command runs through the firmware
+// command loop (main.c) with the engine's inputs taken from the recording
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// replay capture.txt
+// The capture is the meter's answer to "record dump", as saved by a terminal
+// program; the first recording in it is used. The output is what the meter
+// printed for the command, made the same way, so it can be diffed against the
+// field report or against a replay built from other firmware. Waits take no wall
+// time. Exit status is 1 when the run didn't read the recorded inputs in order:
+// the report names the first event it diverged at.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+#include "sim_afe.h"
+#include "sim_uart.h"
+#include "sim_replay.h"
+
+// main.c, built with its main renamed
+void serialCheck(void);
+
+static struct timespec started;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: replay capture.txt\n");
+    exit(2);
+}
+
+// Runs when the command loop ends with its input
+static void reportReplay(void)
+{
+    SIM_REPLAY_STATS stats;
+    struct timespec now;
+    double wall;
+
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wall = (now.tv_sec - started.tv_sec) + (now.tv_nsec - started.tv_nsec) * 1e-9;
+    simReplayGetStats(&stats);
+    fprintf(stderr, "replay: \"%s\", %u of %u events read, %.3f s simulated in %.6f s host time\n",
+            simReplayCommand(), stats.used, stats.events, simTime(), wall);
+    if (stats.wanted)
+        fprintf(stderr, "replay: diverged at event %u asking for '%c', %u skipped, %u missing\n",
+                stats.diverged, stats.wanted, stats.skipped, stats.missing);
+    else if (stats.used < stats.events)
+        fprintf(stderr, "replay: %u events left over\n", stats.events - stats.used);
+    if (stats.wanted || stats.used < stats.events)
+        _exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT open = {SIM_DUT_OPEN, 0, 0, 0, 0};
+    int lines[2];
+
+    if (argc != 2 || argv[1][0] == '-')
+        usage();
+    if (!simReplayLoad(argv[1]))
+        return 1;
+    if (simReplayDropped())
+        fprintf(stderr, "replay: the meter dropped %u events, the run stops short\n", simReplayDropped());
+
+    // the front end only keeps time, every input comes from the recording
+    simInit(&fe, &open);
+    initClock(simReplayTicksPerUs() == 80 ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD);
+    if (getTicksPerUs() != simReplayTicksPerUs())
+    {
+        fprintf(stderr, "replay: no clock profile at %u MHz\n", simReplayTicksPerUs());
+        return 1;
+    }
+
+    // the recorded command is the only input line
+    if (pipe(lines) < 0 || dprintf(lines[1], "%s\n", simReplayCommand()) < 0)
+    {
+        perror("replay: pipe");
+        return 1;
+    }
+    close(lines[1]);
+    simUartAttach(lines[0], STDOUT_FILENO, false);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    atexit(reportReplay);
+    serialCheck();
+    return 0;
+}
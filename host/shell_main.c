@@ -0,0 +1,158 @@
+// LCR meter host simulation
+// The firmware command shell (main.c) with UART0 on stdin/stdout or a
+// pseudo-terminal and the analog front end simulated
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// shell [--pty] [--clock 40|80] [--dut open|short|resistor|capacitance|inductance <value>]
+// stdin/stdout take commands a line at a time and print the replies without
+// carriage returns; the session ends with the input. --pty prints the slave
+// device to open like the meter's COM port and runs until killed. The DUT value
+// is in SI units, a 10k resistor by default. Waits take no wall time, so the
+// throughput report at exit is for the shell and the engine, not the drive timing.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+#include "sim_afe.h"
+#include "sim_uart.h"
+
+// main.c, built with its main renamed
+void serialCheck(void);
+
+static struct timespec started;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: shell [--pty] [--clock 40|80] [--dut open|short|resistor|capacitance|inductance <value>]\n");
+    exit(2);
+}
+
+static void reportThroughput(void)
+{
+    struct timespec now;
+    double wall;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wall = (now.tv_sec - started.tv_sec) + (now.tv_nsec - started.tv_nsec) * 1e-9;
+    fprintf(stderr, "shell: %u commands, %u bytes out, %.3f s wall, %.3f s simulated, %.1f commands/s\n",
+            simUartLines(), simUartTxBytes(), wall, simTime(), wall > 0 ? simUartLines() / wall : 0);
+}
+
+static void stopShell(int signal)
+{
+    exit(0);
+}
+
+static SIM_DUT parseDut(const char *type, double value)
+{
+    SIM_DUT part = {SIM_DUT_RESISTOR, value, 0, 0, 0};
+
+    if (strcmp(type, "open") == 0)
+        part.type = SIM_DUT_OPEN;
+    else if (strcmp(type, "short") == 0)
+        part.type = SIM_DUT_SHORT;
+    else if (strcmp(type, "capacitance") == 0)
+    {
+        part.type = SIM_DUT_CAPACITOR;
+        part.r = 0;
+        part.c = value;
+        part.esr = 0.1;
+    }
+    else if (strcmp(type, "inductance") == 0)
+    {
+        part.type = SIM_DUT_INDUCTOR;
+        part.r = 0.5;
+        part.l = value;
+    }
+    else if (strcmp(type, "resistor") != 0)
+        usage();
+    return part;
+}
+
+// The slave stays open here as well, so the master never reads a hangup
+// between clients
+static int openPty(void)
+{
+    struct termios raw;
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    int slave;
+
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    {
+        perror("shell: pty");
+        exit(1);
+    }
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0)
+    {
+        perror(ptsname(master));
+        exit(1);
+    }
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+    fprintf(stderr, "shell: UART0 on %s\n", ptsname(master));
+    return master;
+}
+
+int main(int argc, char *argv[])
+{
+    CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT part = parseDut("resistor", 10e3);
+    bool pty = false;
+    int master;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--pty") == 0)
+            pty = true;
+        else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc)
+            profile = (atoi(argv[++i]) == 80) ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD;
+        else if (strcmp(argv[i], "--dut") == 0 && i + 2 < argc)
+        {
+            part = parseDut(argv[i + 1], atof(argv[i + 2]));
+            i += 2;
+        }
+        else
+            usage();
+    }
+
+    simInit(&fe, &part);
+    initClock(profile);
+    if (pty)
+    {
+        master = openPty();
+        simUartAttach(master, dup(master), true);
+    }
+    else
+        simUartAttach(STDIN_FILENO, STDOUT_FILENO, false);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    atexit(reportThroughput);
+    signal(SIGINT, stopShell);
+    signal(SIGTERM, stopShell);
+
+    serialCheck();
+    return 0;
+}
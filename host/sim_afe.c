@@ -0,0 +1,427 @@
+// LCR meter host simulation
+// Simulated analog front end: drive transistors, DUT, integrator and comparator
+
+//-----------------------------------------------------------------------------
+// Model
+//-----------------------------------------------------------------------------
+
+// DUT1 is driven to v_high (MEAS_LR), to ground (MEAS_C) or floats.
+// DUT2 is the comparator/ADC node, tied through the optional HIGHSIDE_R,
+// LOWSIDE_R and INTEGRATE branches. Between switching events the circuit is
+// linear with at most two states (integrator voltage, DUT capacitor voltage
+// or inductor current), so it is propagated exactly with a matrix exponential
+// and comparator edges are located by sampling and bisection instead of
+// stepping through simulated time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "hal.h"
+#include "sim_afe.h"
+
+#define STATES          2       // integrator voltage, DUT state
+#define G_LEAK          1e-9    // ADC/comparator input and diode leakage on DUT2
+#define R_SHORT         1e-3
+#define ESR_MIN         1e-3
+#define ADC_VREF        3.3
+#define ADC_COUNTS      4096
+
+#define SAMPLES_PER_DECADE  8
+#define FIRST_SAMPLE        1e-9
+#define BISECTIONS          60
+#define MAX_EDGES           64
+
+static SIM_FRONT_END fe;
+static SIM_DUT dut;
+static uint8_t terminals = 0;
+static double now = 0;
+static double state[STATES];
+
+static bool armed = false;
+static double threshold = 0;
+static double scale = 1.0;
+static SIM_EDGE_HANDLER edgeHandler = 0;
+static uint32_t rng = 1;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// xorshift32, deterministic per seed
+static double simUniform(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng + 0.5) / 4294967296.0;
+}
+
+static double simGauss(void)
+{
+    return sqrt(-2.0 * log(simUniform())) * cos(2.0 * M_PI * simUniform());
+}
+
+SIM_FRONT_END simDefaultFrontEnd(void)
+{
+    SIM_FRONT_END f;
+
+    // ln(v_high / (v_high - vref)): fraction of an RC (or L/R) time constant to the trip point
+    double k;
+
+    f.v_high = 3.288721;                        // Vin of the ESR formula
+    f.vref = 2.469;                             // Vcomp in the schematic
+    k = log(f.v_high / (f.v_high - f.vref));
+
+    f.c_integrate = 1.5308702267422474e-6 / k;  // resistance constant, us per ohm
+    f.r_highside = 0.15 / k / 1e-6;             // capacitance constant 60: 0.15 s per uF
+    f.r_lowside = LOWSIDE_R_OHM;                // inductance constant 52.14
+    f.r_switch = 0.5;
+    f.comparator_offset = 0;
+    f.noise = 0;
+    f.seed = 1;
+    return f;
+}
+
+void simInit(const SIM_FRONT_END *front_end, const SIM_DUT *part)
+{
+    fe = *front_end;
+    dut = *part;
+    terminals = 0;
+    now = 0;
+    memset(state, 0, sizeof(state));
+    armed = false;
+    edgeHandler = 0;
+    scale = 1.0;
+    rng = fe.seed ? fe.seed : 1;
+}
+
+void simSetDut(const SIM_DUT *part)
+{
+    dut = *part;
+    memset(state, 0, sizeof(state));
+}
+
+// DUT1 drive, false when it floats
+static bool dut1Drive(double *v1)
+{
+    if (terminals & TERMINAL_MEAS_C)
+    {
+        *v1 = 0;
+        return true;
+    }
+    if (terminals & TERMINAL_MEAS_LR)
+    {
+        *v1 = fe.v_high;
+        return true;
+    }
+    return false;
+}
+
+// Node voltages and state derivatives for a given state
+static void solve(const double *s, double *v1, double *v2, double *ds)
+{
+    double G = G_LEAK;
+    double J = 0;
+    double drive = 0;
+    double g;
+    bool driven = dut1Drive(&drive);
+
+    if (terminals & TERMINAL_HIGHSIDE_R)
+    {
+        G += 1.0 / fe.r_highside;
+        J += fe.v_high / fe.r_highside;
+    }
+    if (terminals & TERMINAL_LOWSIDE_R)
+        G += 1.0 / fe.r_lowside;
+    if (terminals & TERMINAL_INTEGRATE)
+    {
+        G += 1.0 / fe.r_switch;
+        J += s[0] / fe.r_switch;
+    }
+    if (driven)
+    {
+        switch (dut.type)
+        {
+            case SIM_DUT_SHORT:
+                G += 1.0 / R_SHORT;
+                J += drive / R_SHORT;
+                break;
+            case SIM_DUT_RESISTOR:
+                G += 1.0 / dut.r;
+                J += drive / dut.r;
+                break;
+            case SIM_DUT_CAPACITOR:
+                g = 1.0 / (dut.esr > ESR_MIN ? dut.esr : ESR_MIN);
+                G += g;
+                J += g * (drive - s[1]);
+                break;
+            case SIM_DUT_INDUCTOR:
+                J += s[1];
+                break;
+            default:
+                break;
+        }
+    }
+
+    *v2 = J / G;
+
+    if (driven)
+        *v1 = drive;
+    else if (dut.type == SIM_DUT_OPEN)
+        *v1 = 0;
+    else if (dut.type == SIM_DUT_CAPACITOR)
+        *v1 = *v2 + s[1];
+    else
+        *v1 = *v2;
+
+    ds[0] = (terminals & TERMINAL_INTEGRATE) ? (*v2 - s[0]) / (fe.r_switch * fe.c_integrate) : 0;
+    ds[1] = 0;
+    if (driven && dut.type == SIM_DUT_CAPACITOR)
+        ds[1] = (drive - s[1] - *v2) / (dut.esr > ESR_MIN ? dut.esr : ESR_MIN) / dut.c;
+    if (driven && dut.type == SIM_DUT_INDUCTOR)
+        ds[1] = (drive - *v2 - s[1] * dut.r) / dut.l;
+}
+
+// e^(M) for the augmented 3x3 system by scaling and squaring a Taylor series
+static void expm3(double m[3][3], double e[3][3])
+{
+    double norm = 0;
+    double term[3][3];
+    double tmp[3][3];
+    int squarings = 0;
+    int i, j, k, n;
+
+    for (i = 0; i < 3; i++)
+    {
+        double row = 0;
+        for (j = 0; j < 3; j++)
+            row += fabs(m[i][j]);
+        if (row > norm)
+            norm = row;
+    }
+    if (norm > 0.5)
+        squarings = (int)ceil(log2(norm / 0.5));
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+        {
+            m[i][j] = ldexp(m[i][j], -squarings);
+            e[i][j] = (i == j) ? 1.0 : 0.0;
+            term[i][j] = e[i][j];
+        }
+
+    for (n = 1; n <= 12; n++)
+    {
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+            {
+                tmp[i][j] = 0;
+                for (k = 0; k < 3; k++)
+                    tmp[i][j] += term[i][k] * m[k][j];
+            }
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+            {
+                term[i][j] = tmp[i][j] / n;
+                e[i][j] += term[i][j];
+            }
+    }
+
+    while (squarings-- > 0)
+    {
+        for (i = 0; i < 3; i++)
+            for (j = 0; j < 3; j++)
+            {
+                tmp[i][j] = 0;
+                for (k = 0; k < 3; k++)
+                    tmp[i][j] += e[i][k] * e[k][j];
+            }
+        memcpy(e, tmp, sizeof(tmp));
+    }
+}
+
+// State after dt seconds from s with the current terminals
+static void propagate(const double *s, double dt, double *out)
+{
+    double zero[STATES] = {0};
+    double unit[STATES];
+    double b[STATES];
+    double col[STATES];
+    double m[3][3] = {{0}};
+    double e[3][3];
+    double v1, v2;
+    int i, j;
+
+    solve(zero, &v1, &v2, b);
+    for (j = 0; j < STATES; j++)
+    {
+        memset(unit, 0, sizeof(unit));
+        unit[j] = 1.0;
+        solve(unit, &v1, &v2, col);
+        for (i = 0; i < STATES; i++)
+            m[i][j] = (col[i] - b[i]) * dt;
+    }
+    for (i = 0; i < STATES; i++)
+        m[i][2] = b[i] * dt;
+
+    expm3(m, e);
+    for (i = 0; i < STATES; i++)
+        out[i] = e[i][0] * s[0] + e[i][1] * s[1] + e[i][2];
+}
+
+static double comparatorInput(const double *s)
+{
+    double v1, v2, ds[STATES];
+
+    solve(s, &v1, &v2, ds);
+    return v2 - threshold;
+}
+
+void simSetTerminals(uint8_t value)
+{
+    double before = comparatorInput(state);
+    double drive;
+
+    terminals = value & TERMINAL_ALL;
+
+    // an inductor with DUT1 floating loses its current through the clamp diodes
+    if (dut.type == SIM_DUT_INDUCTOR && !dut1Drive(&drive))
+        state[1] = 0;
+
+    if (armed && edgeHandler && ((before > 0) != (comparatorInput(state) > 0)))
+        edgeHandler(now, comparatorInput(state) > 0);
+}
+
+uint8_t simGetTerminals(void)
+{
+    return terminals;
+}
+
+void simAdvance(double seconds)
+{
+    double base[STATES];
+    double next[STATES];
+    double elapsed = 0;
+    int edges = 0;
+
+    memcpy(base, state, sizeof(base));
+
+    while (armed && edgeHandler && edges < MAX_EDGES)
+    {
+        double remaining = seconds - elapsed;
+        double step = remaining * 1e-9 > FIRST_SAMPLE ? remaining * 1e-9 : FIRST_SAMPLE;
+        double ratio = pow(10.0, 1.0 / SAMPLES_PER_DECADE);
+        double prevT = 0;
+        double prevF = comparatorInput(base);
+        double t;
+        bool found = false;
+
+        if (remaining <= 0)
+            break;
+
+        for (t = step; ; t *= ratio)
+        {
+            double f;
+            if (t > remaining)
+                t = remaining;
+            propagate(base, t, next);
+            f = comparatorInput(next);
+            if ((f > 0) != (prevF > 0))
+            {
+                // bisect between the last two samples
+                double lo = prevT, hi = t;
+                int n;
+                for (n = 0; n < BISECTIONS && hi - lo > 1e-12; n++)
+                {
+                    double mid = 0.5 * (lo + hi);
+                    propagate(base, mid, next);
+                    if ((comparatorInput(next) > 0) == (prevF > 0))
+                        lo = mid;
+                    else
+                        hi = mid;
+                }
+                propagate(base, hi, next);
+                memcpy(base, next, sizeof(base));
+                elapsed += hi;
+                edges++;
+                edgeHandler(now + elapsed, prevF <= 0);
+                found = true;
+                break;
+            }
+            prevT = t;
+            prevF = f;
+            if (t >= remaining)
+                break;
+        }
+        if (!found)
+            break;
+    }
+
+    propagate(base, seconds - elapsed, state);
+    now += seconds;
+}
+
+double simTime(void)
+{
+    return now;
+}
+
+// Comparator threshold, with offset and noise drawn per setting
+static void setThreshold(void)
+{
+    threshold = fe.vref * scale + fe.comparator_offset + fe.noise * simGauss();
+}
+
+void simSetComparatorScale(double value)
+{
+    scale = value;
+    setThreshold();
+}
+
+bool simComparatorTripped(void)
+{
+    return comparatorInput(state) > 0;
+}
+
+void simArmComparator(SIM_EDGE_HANDLER handler)
+{
+    setThreshold();
+    edgeHandler = handler;
+    armed = true;
+}
+
+void simDisarmComparator(void)
+{
+    armed = false;
+}
+
+double simDut1Voltage(void)
+{
+    double v1, v2, ds[STATES];
+
+    solve(state, &v1, &v2, ds);
+    return v1;
+}
+
+double simDut2Voltage(void)
+{
+    double v1, v2, ds[STATES];
+
+    solve(state, &v1, &v2, ds);
+    return v2;
+}
+
+uint16_t simAdcSample(double volts)
+{
+    double counts = (volts + fe.noise * simGauss()) * ADC_COUNTS / ADC_VREF;
+
+    if (counts < 0)
+        return 0;
+    if (counts > ADC_COUNTS - 1)
+        return ADC_COUNTS - 1;
+    return (uint16_t)(counts + 0.5);
+}
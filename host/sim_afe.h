@@ -0,0 +1,79 @@
+// LCR meter host simulation
+// Simulated analog front end: drive transistors, DUT, integrator and comparator
+
+#ifndef SIM_AFE_H_
+#define SIM_AFE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+typedef enum _SIM_DUT_TYPE
+{
+    SIM_DUT_OPEN = 0,
+    SIM_DUT_SHORT,
+    SIM_DUT_RESISTOR,
+    SIM_DUT_CAPACITOR,  // c with series esr
+    SIM_DUT_INDUCTOR    // l with winding resistance r
+} SIM_DUT_TYPE;
+
+// Part between DUT1 and DUT2, SI units
+typedef struct _SIM_DUT
+{
+    SIM_DUT_TYPE type;
+    double r;
+    double l;
+    double c;
+    double esr;
+} SIM_DUT;
+
+// Board model. The defaults are effective values fitted to the firmware
+// calibration constants rather than the schematic's nominal values
+typedef struct _SIM_FRONT_END
+{
+    double v_high;             // DUT1/high side rail after the PNP drop
+    double vref;               // comparator reference
+    double r_highside;         // HIGHSIDE_R charge resistor
+    double r_lowside;          // LOWSIDE_R sense resistor incl. switch
+    double c_integrate;        // INTEGRATE capacitor
+    double r_switch;           // INTEGRATE switch on resistance
+    double comparator_offset;  // added to vref
+    double noise;              // volts rms on the comparator threshold and ADC inputs
+    uint32_t seed;
+} SIM_FRONT_END;
+
+// Called on each comparator edge while armed, with the simulated time of the edge,
+// rising when DUT2 crossed above the threshold
+typedef void (*SIM_EDGE_HANDLER)(double t, bool rising);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+SIM_FRONT_END simDefaultFrontEnd(void);
+void simInit(const SIM_FRONT_END *front_end, const SIM_DUT *dut);
+void simSetDut(const SIM_DUT *dut);
+
+void simSetTerminals(uint8_t terminals);
+uint8_t simGetTerminals(void);
+
+// Advance simulated time, reporting comparator edges while armed
+void simAdvance(double seconds);
+double simTime(void);
+
+void simArmComparator(SIM_EDGE_HANDLER handler);
+void simDisarmComparator(void);
+
+// Reference as a fraction of the front end's vref, takes effect at once (also while armed)
+void simSetComparatorScale(double scale);
+bool simComparatorTripped(void);   // DUT2 above the threshold, armed or not
+
+// Node voltages and 12-bit ADC samples of them
+double simDut1Voltage(void);
+double simDut2Voltage(void);
+uint16_t simAdcSample(double volts);
+
+#endif /* SIM_AFE_H_ */
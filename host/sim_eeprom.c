@@ -0,0 +1,45 @@
+// LCR meter host simulation
+// eeprom.h on the host: the 2 KB EEPROM in RAM, erased (all ones) at start
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "eeprom.h"
+
+#define EEPROM_WORDS (EEPROM_BLOCKS * EEPROM_WORDS_PER_BLOCK)
+
+static uint32_t eeprom[EEPROM_WORDS];
+static bool eepromReady = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool initEeprom(void)
+{
+    if (!eepromReady)
+    {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eepromReady = true;
+    }
+    return true;
+}
+
+void readEeprom(uint16_t address, uint32_t *data, uint16_t words)
+{
+    initEeprom();
+    while (words-- && address < EEPROM_WORDS)
+        *data++ = eeprom[address++];
+}
+
+bool writeEeprom(uint16_t address, const uint32_t *data, uint16_t words)
+{
+    initEeprom();
+    if (address + words > EEPROM_WORDS)
+        return false;
+    memcpy(&eeprom[address], data, words * sizeof(uint32_t));
+    return true;
+}
@@ -0,0 +1,472 @@
+// LCR meter host simulation
+// clock.h, power.h and hal.h implemented against the simulated analog front end,
+// with the inputs taken from a recording instead while one is replayed
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "clock.h"
+#include "power.h"
+#include "hal.h"
+#include "uart.h"
+#include "trace.h"
+#include "record.h"
+#include "sim_afe.h"
+#include "sim_uart.h"
+#include "sim_replay.h"
+
+static const uint32_t clockHz[] = {40000000, 80000000};
+
+static CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+static POWER_MODE powerMode = POWER_MODE_RUN;
+static double captureStart = 0;
+uint32_t resistor_time_value = 0;
+
+static CAPTURE_EDGE captureQueue[CAPTURE_QUEUE_DEPTH];
+static uint8_t captureHead = 0;
+static uint8_t captureTail = 0;
+static uint32_t captureOverflows = 0;
+static uint8_t comparatorLevels[COMPARATOR_LEVELS_MAX] = {COMPARATOR_LEVEL_DEFAULT};
+static uint8_t levelCount = 1;
+static uint8_t levelIndex = 0;
+
+static uint32_t userFlash[USER_FLASH_WORDS];
+static bool userFlashReady = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Clock: profiles only change the capture resolution
+void initClock(CLOCK_PROFILE p)
+{
+    profile = p;
+}
+
+void setClockProfile(CLOCK_PROFILE p)
+{
+    profile = p;
+}
+
+CLOCK_PROFILE getClockProfile(void)
+{
+    return profile;
+}
+
+uint32_t getSysClockHz(void)
+{
+    return clockHz[profile];
+}
+
+uint32_t getTicksPerUs(void)
+{
+    return clockHz[profile] / 1000000;
+}
+
+float ticksToMicroseconds(uint32_t ticks)
+{
+    return (float)ticks / getTicksPerUs();
+}
+
+uint32_t microsecondsToTicks(uint32_t us)
+{
+    uint64_t ticks = (uint64_t)us * getTicksPerUs();
+
+    return ticks > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)ticks;
+}
+
+// Comparator reference relative to the default level, VDDA * (8 + level) / 32
+static void setComparatorReference(uint8_t level)
+{
+    simSetComparatorScale((8.0 + level) / (8.0 + COMPARATOR_LEVEL_DEFAULT));
+}
+
+// Waits advance simulated time instead of spinning
+void waitMicrosecond(uint32_t us)
+{
+    simAdvance(us * 1e-6);
+}
+
+void sleepMicrosecond(uint32_t us)
+{
+    simAdvance(us * 1e-6);
+}
+
+// Time jumps straight to the next event. Received bytes are the only event that
+// can come before the deadline; they are already there when they exist at all,
+// so the RX interrupt would wake the sleep at once.
+bool sleepMicrosecondUntil(uint32_t us, bool (*stop)(void))
+{
+    RECORD_EVENT event;
+    bool stopped;
+
+    if (stop && simReplaying())
+    {
+        stopped = simReplayInput(RECORD_WAIT, &event) && event.level;
+        if (!stopped)
+            simAdvance(us * 1e-6);
+    }
+    else if (stop && kbhitUart0() && stop())
+        stopped = true;
+    else
+    {
+        simAdvance(us * 1e-6);
+        stopped = stop && stop();
+    }
+    if (stop)
+        recordInput(RECORD_WAIT, 0, 0, 0, stopped);
+    return stopped;
+}
+
+// Power: the mode is kept for reporting, idle never sleeps
+void setPowerMode(POWER_MODE mode)
+{
+    powerMode = mode;
+}
+
+POWER_MODE getPowerMode(void)
+{
+    return powerMode;
+}
+
+const char * getPowerModeName(POWER_MODE mode)
+{
+    switch (mode)
+    {
+        case POWER_MODE_RUN:        return "run";
+        case POWER_MODE_SLEEP:      return "sleep";
+        case POWER_MODE_DEEP_SLEEP: return "deep";
+    }
+    return "unknown";
+}
+
+uint32_t getWakeCount(void)
+{
+    return 0;
+}
+
+uint32_t getLastWakeRestoreUs(void)
+{
+    return 0;
+}
+
+uint32_t getMaxWakeRestoreUs(void)
+{
+    return 0;
+}
+
+// Idle means waiting for a command: the shell blocks on its input, simulated time
+// stands still, and the session ends with the input
+void powerIdle(void)
+{
+    if (!simUartWait())
+        exit(0);
+}
+
+// Hal
+void initSerialHw()
+{
+    resetOutputTerminals();
+}
+
+void setTerminal(uint8_t terminal, bool on)
+{
+    uint8_t terminals = simGetTerminals();
+
+    simSetTerminals(on ? (terminals | terminal) : (terminals & ~terminal));
+    traceTerminals(simGetTerminals());
+}
+
+void resetOutputTerminals()
+{
+    simSetTerminals(0);
+    traceTerminals(0);
+}
+
+uint8_t getTerminals()
+{
+    return simGetTerminals();
+}
+
+int16_t readAdc0Ss3()
+{
+    RECORD_EVENT event;
+    int16_t sample;
+
+    if (simReplaying())
+        sample = simReplayInput(RECORD_ADC0, &event) ? event.dut1 : 0;
+    else
+        sample = simAdcSample(simDut1Voltage());
+    recordInput(RECORD_ADC0, 0, sample, 0, 0);
+    return sample;
+}
+
+int16_t readAdc1Ss3()
+{
+    RECORD_EVENT event;
+    int16_t sample;
+
+    if (simReplaying())
+        sample = simReplayInput(RECORD_ADC1, &event) ? event.dut2 : 0;
+    else
+        sample = simAdcSample(simDut2Voltage());
+    recordInput(RECORD_ADC1, 0, 0, sample, 0);
+    return sample;
+}
+
+// The ADCs convert a pair in about a microsecond
+void readAdcBurst(ADC_PAIR *samples, uint16_t count)
+{
+    RECORD_EVENT event;
+    double start = simTime();
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        simAdvance(1e-6);
+        if (simReplaying())
+        {
+            if (!simReplayInput(RECORD_PAIR, &event))
+                memset(&event, 0, sizeof(event));
+            samples[i].dut1 = event.dut1;
+            samples[i].dut2 = event.dut2;
+            samples[i].ticks = event.ticks;
+        }
+        else
+        {
+            samples[i].dut1 = simAdcSample(simDut1Voltage());
+            samples[i].dut2 = simAdcSample(simDut2Voltage());
+            samples[i].ticks = (uint32_t)((simTime() - start) * getSysClockHz());
+        }
+        recordInput(RECORD_PAIR, samples[i].ticks, samples[i].dut1, samples[i].dut2, 0);
+    }
+}
+
+// Trip at simulated time t: the wide timer value since startCapture, queued and
+// the reference stepped as analogComparator05Isr does
+static void captureEdge(double t, bool rising)
+{
+    double ticks = (t - captureStart) * getSysClockHz();
+
+    if (!rising)
+        return;
+    resistor_time_value = ticks > 4294967295.0 ? 0xFFFFFFFF : (uint32_t)ticks;
+
+    if ((uint8_t)(captureHead - captureTail) < CAPTURE_QUEUE_DEPTH)
+    {
+        captureQueue[captureHead % CAPTURE_QUEUE_DEPTH].ticks = resistor_time_value;
+        captureQueue[captureHead % CAPTURE_QUEUE_DEPTH].level = comparatorLevels[levelIndex];
+        captureHead++;
+    }
+    else
+        captureOverflows++;
+
+    if (levelIndex + 1 < levelCount)
+        setComparatorReference(comparatorLevels[++levelIndex]);
+}
+
+void setComparatorLevels(const uint8_t *levels, uint8_t count)
+{
+    uint8_t i;
+
+    if (count == 0)
+    {
+        comparatorLevels[0] = COMPARATOR_LEVEL_DEFAULT;
+        count = 1;
+    }
+    else
+    {
+        if (count > COMPARATOR_LEVELS_MAX)
+            count = COMPARATOR_LEVELS_MAX;
+        for (i = 0; i < count; i++)
+            comparatorLevels[i] = levels[i];
+    }
+    levelCount = count;
+}
+
+bool getCaptureEdge(CAPTURE_EDGE *edge)
+{
+    RECORD_EVENT event;
+
+    if (simReplaying())
+    {
+        if (!simReplayInput(RECORD_EDGE, &event) || event.type == RECORD_NO_EDGE)
+        {
+            recordInput(RECORD_NO_EDGE, 0, 0, 0, 0);
+            return false;
+        }
+        edge->ticks = event.ticks;
+        edge->level = event.level;
+    }
+    else
+    {
+        if (captureTail == captureHead)
+        {
+            recordInput(RECORD_NO_EDGE, 0, 0, 0, 0);
+            return false;
+        }
+        *edge = captureQueue[captureTail % CAPTURE_QUEUE_DEPTH];
+        captureTail++;
+    }
+    recordInput(RECORD_EDGE, edge->ticks, 0, 0, edge->level);
+    return true;
+}
+
+uint32_t getCaptureOverflows()
+{
+    return captureOverflows;
+}
+
+void startCapture()
+{
+    resistor_time_value = 0;
+    captureTail = captureHead;
+    levelIndex = 0;
+    setComparatorReference(comparatorLevels[0]);
+    captureStart = simTime();
+    simArmComparator(captureEdge);
+}
+
+void stopCapture()
+{
+    simDisarmComparator();
+}
+
+uint32_t getCaptureTicks()
+{
+    RECORD_EVENT event;
+    uint32_t ticks = resistor_time_value;
+
+    if (simReplaying())
+        ticks = simReplayInput(RECORD_CAPTURE, &event) ? event.ticks : 0;
+    recordInput(RECORD_CAPTURE, ticks, 0, 0, 0);
+    return ticks;
+}
+
+void analogComparator05Isr()
+{
+}
+
+// The same phases and switch order as on target, each exactly CHARGE_PHASE_US
+uint32_t countChargeTransfers(uint8_t level, uint32_t max_cycles)
+{
+    RECORD_EVENT event;
+    uint32_t cycles = 0;
+    bool tripped = false;
+
+    if (simReplaying())
+    {
+        cycles = simReplayInput(RECORD_CHARGE, &event) ? event.ticks : 0;
+        recordInput(RECORD_CHARGE, cycles, 0, 0, level);
+        return cycles;
+    }
+
+    setComparatorReference(level);
+    while (!tripped && cycles < max_cycles)
+    {
+        simSetTerminals(TERMINAL_LOWSIDE_R);
+        simSetTerminals(TERMINAL_LOWSIDE_R | TERMINAL_MEAS_C);
+        simAdvance(CHARGE_PHASE_US * 1e-6);
+
+        simSetTerminals(0);
+        simSetTerminals(TERMINAL_MEAS_LR | TERMINAL_INTEGRATE);
+        simAdvance(CHARGE_PHASE_US * 1e-6);
+
+        cycles++;
+        tripped = simComparatorTripped();
+    }
+    resetOutputTerminals();
+    setComparatorReference(COMPARATOR_LEVEL_DEFAULT);
+
+    if (!tripped)
+        cycles = 0;
+    recordInput(RECORD_CHARGE, cycles, 0, 0, level);
+    return cycles;
+}
+
+// User flash page in RAM, erased at start
+const uint32_t * getUserFlash()
+{
+    if (!userFlashReady)
+    {
+        memset(userFlash, 0xFF, sizeof(userFlash));
+        userFlashReady = true;
+    }
+    return userFlash;
+}
+
+bool writeUserFlash(const uint32_t *page)
+{
+    memcpy(userFlash, page, sizeof(userFlash));
+    userFlashReady = true;
+    return true;
+}
+
+uint64_t getUptimeUs()
+{
+    return (uint64_t)(simTime() * 1e6);
+}
+
+// The simulated core never hangs, measurements time out on their own deadline
+void initWatchdog()
+{
+}
+
+void loadWatchdog(uint32_t us)
+{
+    (void)us;
+}
+
+void feedWatchdog()
+{
+}
+
+void rearmWatchdog()
+{
+}
+
+bool wasWatchdogReset()
+{
+    return false;
+}
+
+void watchdogIsr()
+{
+    resetOutputTerminals();
+}
+
+// TSC on x86 hosts, nanoseconds elsewhere
+void initCycleCounter()
+{
+}
+
+uint32_t getCycleCount()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+// No reservation to stay in, the host's stack is megabytes deep
+uintptr_t getStackLimit()
+{
+    return 0;
+}
+
+// Simulated time, so traces show the drive timing rather than the host's
+uint32_t getTraceTicks()
+{
+    return (uint32_t)(uint64_t)(simTime() * getSysClockHz());
+}
@@ -0,0 +1,186 @@
+// LCR meter host simulation
+// Replay source: the engine's inputs from a recording the meter dumped (record.h)
+// in place of the simulated front end
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "record.h"
+#include "sim_replay.h"
+
+static RECORD_EVENT *events = NULL;
+static uint32_t eventCount = 0;
+static uint32_t cursor = 0;
+static uint32_t ticksPerUs = 40;
+static uint32_t dropped = 0;
+static char command[RECORD_COMMAND_LENGTH + 1] = "";
+static SIM_REPLAY_STATS stats;
+static bool replaying = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// One dump line, false for anything that isn't an event
+static bool parseEvent(const char *line, RECORD_EVENT *event)
+{
+    unsigned ticks = 0, level = 0;
+    int dut1 = 0, dut2 = 0;
+    bool ok;
+
+    memset(event, 0, sizeof(*event));
+    event->type = line[0];
+    switch (line[0])
+    {
+        case RECORD_ADC0:
+            ok = sscanf(line + 1, "%d", &dut1) == 1;
+            break;
+        case RECORD_ADC1:
+            ok = sscanf(line + 1, "%d", &dut2) == 1;
+            break;
+        case RECORD_PAIR:
+            ok = sscanf(line + 1, "%d %d %u", &dut1, &dut2, &ticks) == 3;
+            break;
+        case RECORD_CAPTURE:
+            ok = sscanf(line + 1, "%u", &ticks) == 1;
+            break;
+        case RECORD_EDGE:
+        case RECORD_CHARGE:
+            ok = sscanf(line + 1, "%u %u", &ticks, &level) == 2;
+            break;
+        case RECORD_NO_EDGE:
+            ok = line[1] == 0 || line[1] == '\r' || line[1] == '\n';
+            break;
+        case RECORD_WAIT:
+            ok = sscanf(line + 1, "%u", &level) == 1;
+            break;
+        default:
+            ok = false;
+            break;
+    }
+    event->ticks = ticks;
+    event->dut1 = dut1;
+    event->dut2 = dut2;
+    event->level = level;
+    return ok;
+}
+
+bool simReplayLoad(const char *path)
+{
+    char line[160];
+    unsigned clock, count, lost;
+    int offset;
+    bool inside = false, ended = false;
+    RECORD_EVENT event;
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    simReplayStop();
+    while (!ended && fgets(line, sizeof(line), f))
+    {
+        char *text = line + strspn(line, " \t");
+
+        if (!inside)
+        {
+            if (sscanf(text, "recording %u %u %u %n", &clock, &count, &lost, &offset) == 3 && clock > 0)
+            {
+                inside = true;
+                ticksPerUs = clock;
+                dropped = lost;
+                strncpy(command, text + offset, RECORD_COMMAND_LENGTH);
+                command[strcspn(command, "\r\n")] = 0;
+                events = calloc(count ? count : 1, sizeof(RECORD_EVENT));
+                eventCount = 0;
+                if (!events)
+                    break;
+            }
+        }
+        else if (strncmp(text, "recording end", 13) == 0)
+            ended = true;
+        else if (parseEvent(text, &event) && eventCount < count)
+            events[eventCount++] = event;
+    }
+    fclose(f);
+    if (!ended)
+    {
+        fprintf(stderr, "%s: no complete recording\n", path);
+        return false;
+    }
+    memset(&stats, 0, sizeof(stats));
+    stats.events = eventCount;
+    cursor = 0;
+    replaying = true;
+    return true;
+}
+
+void simReplayStop(void)
+{
+    replaying = false;
+    free(events);
+    events = NULL;
+    eventCount = 0;
+}
+
+bool simReplaying(void)
+{
+    return replaying;
+}
+
+const char * simReplayCommand(void)
+{
+    return command;
+}
+
+uint32_t simReplayTicksPerUs(void)
+{
+    return ticksPerUs;
+}
+
+uint32_t simReplayDropped(void)
+{
+    return dropped;
+}
+
+static bool matches(const RECORD_EVENT *event, RECORD_TYPE type)
+{
+    return event->type == type || (type == RECORD_EDGE && event->type == RECORD_NO_EDGE);
+}
+
+// In order while the run reads what the meter read; after a divergence the
+// next event of the type is taken, so a changed algorithm can still run
+bool simReplayInput(RECORD_TYPE type, RECORD_EVENT *event)
+{
+    uint32_t i = cursor;
+
+    while (i < eventCount && !matches(&events[i], type))
+        i++;
+    if ((i != cursor || i == eventCount) && !stats.wanted)
+    {
+        stats.diverged = cursor;
+        stats.wanted = type;
+    }
+    if (i == eventCount)
+    {
+        stats.missing++;
+        return false;
+    }
+    stats.skipped += i - cursor;
+    stats.used++;
+    *event = events[i];
+    cursor = i + 1;
+    return true;
+}
+
+void simReplayGetStats(SIM_REPLAY_STATS *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,45 @@
+// LCR meter host simulation
+// Replay source: the engine's inputs from a recording the meter dumped (record.h)
+// in place of the simulated front end
+
+#ifndef SIM_REPLAY_H_
+#define SIM_REPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "record.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// How well the run followed the recording
+typedef struct _SIM_REPLAY_STATS
+{
+    uint32_t events;               // in the recording
+    uint32_t used;
+    uint32_t skipped;              // passed over to find the type asked for
+    uint32_t missing;              // asked for with none of the type left
+    uint32_t diverged;             // index of the first event not used in order
+    char wanted;                   // type asked for there, 0 if the run never diverged
+} SIM_REPLAY_STATS;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// The first recording in a "record dump" capture, other lines are ignored
+bool simReplayLoad(const char *path);
+void simReplayStop(void);          // back to the simulated front end
+bool simReplaying(void);
+const char * simReplayCommand(void);
+uint32_t simReplayTicksPerUs(void);
+uint32_t simReplayDropped(void);
+
+// Next event of the type, RECORD_EDGE also takes RECORD_NO_EDGE. False when the
+// recording has none left.
+bool simReplayInput(RECORD_TYPE type, RECORD_EVENT *event);
+
+void simReplayGetStats(SIM_REPLAY_STATS *stats);
+
+#endif /* SIM_REPLAY_H_ */
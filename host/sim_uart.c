@@ -0,0 +1,174 @@
+// LCR meter host simulation
+// UART0 on the host: detached (no input, output counted) for the batch tools, or
+// attached to stdin/stdout or a pseudo-terminal for the command shell
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <unistd.h>
+#include "clock.h"
+#include "uart.h"
+#include "sim_uart.h"
+
+static uint32_t baudRate = UART0_DEFAULT_BAUD;
+static int inFd = -1;
+static FILE *out = NULL;
+static bool rawLink = false;
+static bool inputEnded = false;
+static bool lineHeld = false;
+static char lastRx = 0;
+static uint32_t rxLines = 0;
+static uint32_t uartTxBytes = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void simUartAttach(int in_fd, int out_fd, bool raw)
+{
+    inFd = in_fd;
+    out = fdopen(out_fd, "w");
+    rawLink = raw;
+    inputEnded = false;
+}
+
+// Readable within timeout_ms (-1 waits for good); a hangup with nothing left to read ends the input
+static bool inputReady(int timeout_ms)
+{
+    struct pollfd p = {inFd, POLLIN, 0};
+
+    if (inFd < 0 || inputEnded)
+        return false;
+    if (poll(&p, 1, timeout_ms) <= 0)
+        return false;
+    if (!(p.revents & POLLIN))
+    {
+        inputEnded = true;
+        return false;
+    }
+    return true;
+}
+
+// The shell is idle, the next scripted line can come in
+bool simUartWait(void)
+{
+    if (out)
+        fflush(out);
+    lineHeld = false;
+    return inputReady(-1);
+}
+
+uint32_t simUartLines(void)
+{
+    return rxLines;
+}
+
+uint32_t simUartTxBytes(void)
+{
+    return uartTxBytes;
+}
+
+void initUart0(uint32_t baud)
+{
+    baudRate = baud;
+}
+
+void setUart0Baud(uint32_t baud)
+{
+    baudRate = baud;
+}
+
+void setUart0ClockSource(bool piosc)
+{
+}
+
+uint32_t getUart0Baud(void)
+{
+    return baudRate;
+}
+
+// Same limits as the target, the host link has no divisor error
+bool isUart0BaudSupported(uint32_t baud)
+{
+    return baud >= 9600 && baud <= getSysClockHz() / 8;
+}
+
+bool negotiateUart0Baud(uint32_t baud)
+{
+    baudRate = baud;
+    return true;
+}
+
+uint32_t getUart0BaudFallbacks(void)
+{
+    return 0;
+}
+
+void flushUart0(void)
+{
+    if (out)
+        fflush(out);
+}
+
+void putcUart0(char c)
+{
+    uartTxBytes++;
+    if (out && (rawLink || c != '\r'))
+        putc(c, out);
+}
+
+void putsUart0(char* str)
+{
+    while (*str)
+        putcUart0(*str++);
+}
+
+// A script is typed one line at a time: after a line end nothing more arrives
+// until the shell is idle again, so every command runs to completion
+bool kbhitUart0(void)
+{
+    return !lineHeld && inputReady(0);
+}
+
+// Only called after kbhitUart0. A failed read ends the input, and ends the last
+// line too if it had no line end of its own
+char getcUart0()
+{
+    char c;
+
+    if (read(inFd, &c, 1) != 1)
+    {
+        inputEnded = true;
+        c = (lastRx != 0 && lastRx != '\r' && lastRx != '\n') ? '\r' : 0;
+        lastRx = c;
+        if (c == '\r')
+            rxLines++;
+        return c;
+    }
+    if (!rawLink && c == '\n')
+    {
+        // a CR LF pair is one line end
+        if (lastRx == '\r')
+        {
+            lastRx = c;
+            return 0;
+        }
+        c = '\r';
+    }
+    lastRx = c;
+    if (c == '\r')
+    {
+        rxLines++;
+        lineHeld = !rawLink;
+    }
+    return c;
+}
+
+uint32_t getUart0RxOverflows(void)
+{
+    return 0;
+}
@@ -0,0 +1,25 @@
+// LCR meter host simulation
+// UART0 on the host: detached (no input, output counted) for the batch tools, or
+// attached to stdin/stdout or a pseudo-terminal for the command shell
+
+#ifndef SIM_UART_H_
+#define SIM_UART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// raw passes bytes through as a terminal sends them; otherwise input line feeds
+// end commands and output carriage returns are dropped, as for a text file
+void simUartAttach(int in_fd, int out_fd, bool raw);
+
+// Flushes output and blocks until input is ready, false once the input has ended
+bool simUartWait(void);
+
+uint32_t simUartLines(void);       // carriage returns received, one per command
+uint32_t simUartTxBytes(void);
+
+#endif /* SIM_UART_H_ */
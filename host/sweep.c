@@ -0,0 +1,352 @@
+// LCR meter host simulation
+// Monte-Carlo accuracy versus reading time sweep: runs the drive sequences with
+// scaled waits against randomized parts and front ends, on every core, and marks
+// the Pareto-optimal settings per component decade
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// sweep [--trials n] [--jobs n] [--tolerance pct] [--noise volts] [--offset volts]
+//       [--seed n] > pareto.csv
+// Each setting scales the settle waits (SEQ_WAIT) and the capture windows
+// (SEQ_CAPTURE) of the built-in resistor, capacitance and inductance sequences.
+// Every trial draws the part within +-tolerance of the decade's value, the noise
+// up to --noise and the comparator offset within +-offset. Time is the simulated
+// reading time including the DUT check; error is against the drawn value, and a
+// reading that fails counts as 100 %. A setting that read every trial is on the
+// Pareto front when no other such setting for the same decade is both faster and
+// more accurate.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "sim_afe.h"
+
+#define FAILED_ERROR    100.0      // percent, for readings without a value
+
+typedef struct _METHOD
+{
+    const char *name;
+    COMPONENT component;
+    const SEQ_OP *sequence;
+    double first;                  // decades swept, SI units
+    int decades;
+    double to_firmware;            // SI to the firmware's unit
+} METHOD;
+
+static const METHOD methods[] =
+{
+    {"resistor", COMPONENT_RESISTOR, seqResistance, 10.0, 6, 1e-3},
+    {"capacitance", COMPONENT_CAPACITOR, seqCapacitance, 1e-9, 6, 1e6},
+    {"inductance", COMPONENT_INDUCTOR, seqInductance, 10e-6, 5, 1e6},
+};
+
+#define METHODS (sizeof(methods) / sizeof(methods[0]))
+
+static const double settleScales[] = {0.05, 0.1, 0.25, 0.5, 1.0};
+static const double windowScales[] = {0.1, 0.25, 0.5, 1.0};
+
+#define SETTLES (sizeof(settleScales) / sizeof(settleScales[0]))
+#define WINDOWS (sizeof(windowScales) / sizeof(windowScales[0]))
+
+// One method, decade and setting; the result is filled by a worker
+typedef struct _TASK
+{
+    uint8_t method;
+    uint8_t decade;
+    uint8_t settle;
+    uint8_t window;
+    double time_s;                 // mean reading time
+    double rms_error;              // percent
+    double max_error;
+    uint32_t failures;
+    bool pareto;
+} TASK;
+
+// Worker to parent, one write each so records from different workers never interleave
+typedef struct _RESULT
+{
+    uint32_t index;
+    TASK task;
+} RESULT;
+
+typedef struct _SWEEP
+{
+    int trials;
+    double tolerance;              // fraction
+    double noise;                  // volts
+    double offset;
+    uint32_t seed;
+} SWEEP;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: sweep [--trials n] [--jobs n] [--tolerance pct] [--noise volts] [--offset volts] [--seed n]\n");
+    exit(2);
+}
+
+// xorshift32, seeded per task so results don't depend on the job count
+static double uniform(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state >> 8) * (1.0 / 16777216.0);
+}
+
+static void scaleSequence(const SEQ_OP *src, SEQ_OP *dst, double settle, double window)
+{
+    int i;
+
+    for (i = 0; i < SEQ_MAX_OPS; i++)
+    {
+        dst[i] = src[i];
+        if (src[i].code == SEQ_WAIT)
+            dst[i].value = (uint32_t)lround(src[i].value * settle);
+        else if (src[i].code == SEQ_CAPTURE)
+            dst[i].value = (uint32_t)lround(src[i].value * window);
+        else if (src[i].code == SEQ_END)
+            break;
+    }
+}
+
+// Same parasitics as gen_lut's model parts
+static SIM_DUT makePart(const METHOD *m, double value)
+{
+    SIM_DUT part = {SIM_DUT_RESISTOR, value, 0, 0, 0};
+
+    if (m->component == COMPONENT_CAPACITOR)
+    {
+        part.type = SIM_DUT_CAPACITOR;
+        part.r = 0;
+        part.c = value;
+        part.esr = 0.1;
+    }
+    else if (m->component == COMPONENT_INDUCTOR)
+    {
+        part.type = SIM_DUT_INDUCTOR;
+        part.l = value;
+        part.r = 0.05 * pow(value / 10e-6, 2.0 / 3.0);
+    }
+    return part;
+}
+
+static void runTask(TASK *task, uint32_t index, const SWEEP *sweep)
+{
+    const METHOD *m = &methods[task->method];
+    SEQ_OP sequence[SEQ_MAX_OPS];
+    uint32_t random = sweep->seed ^ (0x9E3779B9u * (index + 1));
+    double errorSquares = 0;
+    double timeTotal = 0;
+    int trial;
+
+    scaleSequence(m->sequence, sequence, settleScales[task->settle], windowScales[task->window]);
+    task->max_error = 0;
+    task->failures = 0;
+
+    for (trial = 0; trial < sweep->trials; trial++)
+    {
+        SIM_FRONT_END fe = simDefaultFrontEnd();
+        double value = m->first * pow(10.0, task->decade) * (1.0 + sweep->tolerance * (2.0 * uniform(&random) - 1.0));
+        SIM_DUT part = makePart(m, value);
+        MEASUREMENT result = {0};
+        MEASURE_STATUS status;
+        double error;
+
+        fe.noise = sweep->noise * uniform(&random);
+        fe.comparator_offset += sweep->offset * (2.0 * uniform(&random) - 1.0);
+        fe.seed = random;
+        simInit(&fe, &part);
+        initClock(CLOCK_PROFILE_STANDARD);
+        initSerialHw();
+
+        status = checkDut(m->component);
+        if (status == MEASURE_OK)
+        {
+            result = measureSequence(sequence);
+            status = result.status;
+        }
+        timeTotal += simTime();
+
+        error = FAILED_ERROR;
+        if (status == MEASURE_OK)
+            error = fmin(FAILED_ERROR, 100.0 * fabs(result.value - value * m->to_firmware) / (value * m->to_firmware));
+        else
+            task->failures++;
+        errorSquares += error * error;
+        task->max_error = fmax(task->max_error, error);
+    }
+    task->time_s = timeTotal / sweep->trials;
+    task->rms_error = sqrt(errorSquares / sweep->trials);
+}
+
+// Worker job: every jobs-th task from first, results written back in task order
+static void runWorker(TASK *tasks, uint32_t count, uint32_t first, uint32_t jobs, const SWEEP *sweep, int fd)
+{
+    RESULT result;
+    uint32_t i;
+
+    for (i = first; i < count; i += jobs)
+    {
+        runTask(&tasks[i], i, sweep);
+        result.index = i;
+        result.task = tasks[i];
+        if (write(fd, &result, sizeof(result)) != sizeof(result))
+            _exit(1);
+    }
+    _exit(0);
+}
+
+// The simulation keeps its state in globals, so the parallelism is processes
+static bool runParallel(TASK *tasks, uint32_t count, uint32_t jobs, const SWEEP *sweep)
+{
+    int fds[2];
+    uint32_t received = 0, j;
+    RESULT result;
+    int status;
+    bool ok = true;
+
+    if (pipe(fds) < 0)
+    {
+        perror("sweep: pipe");
+        return false;
+    }
+    for (j = 0; j < jobs; j++)
+    {
+        pid_t pid = fork();
+
+        if (pid < 0)
+        {
+            perror("sweep: fork");
+            exit(1);
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            runWorker(tasks, count, j, jobs, sweep, fds[1]);
+        }
+    }
+    close(fds[1]);
+
+    while (read(fds[0], &result, sizeof(result)) == sizeof(result))
+    {
+        if (result.index < count)
+        {
+            tasks[result.index] = result.task;
+            received++;
+        }
+    }
+    close(fds[0]);
+
+    while (wait(&status) > 0)
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = false;
+    return ok && received == count;
+}
+
+// Only settings that read every trial are candidates. One is dominated when
+// another for the same decade is no slower and no less accurate, and better in one
+static void markPareto(TASK *tasks, uint32_t count)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        tasks[i].pareto = tasks[i].failures == 0;
+        for (j = 0; j < count && tasks[i].pareto; j++)
+        {
+            if (j == i || tasks[j].failures || tasks[j].method != tasks[i].method || tasks[j].decade != tasks[i].decade)
+                continue;
+            if (tasks[j].time_s <= tasks[i].time_s && tasks[j].rms_error <= tasks[i].rms_error &&
+                (tasks[j].time_s < tasks[i].time_s || tasks[j].rms_error < tasks[i].rms_error))
+                tasks[i].pareto = false;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    SWEEP sweep = {200, 0.05, 0.005, 0.002, 1};
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    TASK *tasks;
+    uint32_t count = 0, i;
+    unsigned m, d, s, w;
+
+    for (i = 1; i < (uint32_t)argc; i++)
+    {
+        if (i + 1 >= (uint32_t)argc)
+            usage();
+        else if (strcmp(argv[i], "--trials") == 0)
+            sweep.trials = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--jobs") == 0)
+            jobs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--tolerance") == 0)
+            sweep.tolerance = atof(argv[++i]) / 100.0;
+        else if (strcmp(argv[i], "--noise") == 0)
+            sweep.noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "--offset") == 0)
+            sweep.offset = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            sweep.seed = strtoul(argv[++i], NULL, 0);
+        else
+            usage();
+    }
+    if (sweep.trials < 1 || jobs < 1)
+        usage();
+
+    for (m = 0; m < METHODS; m++)
+        count += methods[m].decades * SETTLES * WINDOWS;
+    tasks = calloc(count, sizeof(TASK));
+    if (!tasks)
+        return 1;
+    count = 0;
+    for (m = 0; m < METHODS; m++)
+        for (d = 0; d < (unsigned)methods[m].decades; d++)
+            for (s = 0; s < SETTLES; s++)
+                for (w = 0; w < WINDOWS; w++)
+                {
+                    tasks[count].method = m;
+                    tasks[count].decade = d;
+                    tasks[count].settle = s;
+                    tasks[count].window = w;
+                    count++;
+                }
+    if ((uint32_t)jobs > count)
+        jobs = count;
+
+    if (!runParallel(tasks, count, jobs, &sweep))
+    {
+        fprintf(stderr, "sweep: a worker failed\n");
+        return 1;
+    }
+    markPareto(tasks, count);
+
+    printf("method,decade,settle_scale,window_scale,time_s,rms_error_pct,max_error_pct,failures,trials,pareto\n");
+    for (i = 0; i < count; i++)
+    {
+        const TASK *t = &tasks[i];
+
+        printf("%s,%g,%g,%g,%.6f,%.3f,%.3f,%u,%d,%d\n",
+               methods[t->method].name, methods[t->method].first * pow(10.0, t->decade),
+               settleScales[t->settle], windowScales[t->window],
+               t->time_s, t->rms_error, t->max_error, t->failures, sweep.trials, t->pareto);
+    }
+    fprintf(stderr, "sweep: %u settings, %u trials each, %ld jobs\n", count, sweep.trials, jobs);
+    return 0;
+}
@@ -0,0 +1,23 @@
+// LCR meter host simulation
+// Stand-in for the TivaWare device header, only for main.c in the host shell:
+// the registers main.c touches directly are plain variables that nothing reads
+// back, the rest of the hardware goes through hal.h
+
+#ifndef TM4C123GH6PM_H_
+#define TM4C123GH6PM_H_
+
+#include <stdint.h>
+
+static volatile uint32_t GPIO_PORTF_DATA_R = 0;   // SW1 reads as pressed
+static volatile uint32_t NVIC_APINT_R;
+
+// Status LEDs, main.c defines its bit-band aliases unless these are there
+static volatile uint32_t simRedLed;
+static volatile uint32_t simGreenLed;
+#define RED_LED                 simRedLed
+#define GREEN_LED               simGreenLed
+
+#define NVIC_APINT_VECTKEY      0x05FA0000
+#define NVIC_APINT_SYSRESETREQ  0x00000004
+
+#endif /* TM4C123GH6PM_H_ */
@@ -0,0 +1,105 @@
+// LCR meter host simulation
+// Runs one measurement against a simulated part with the drive trace on and
+// writes the terminal waveform as VCD
+
+//-----------------------------------------------------------------------------
+// Usage
+//-----------------------------------------------------------------------------
+
+// trace [--clock 40|80] resistor|capacitance|inductance|esr <value> > drive.vcd
+// The value is in SI units (ohm, farad, henry); esr measures a 10 uH inductor
+// with <value> ohm of winding resistance. Times are simulated time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock.h"
+#include "hal.h"
+#include "measure.h"
+#include "trace.h"
+#include "sim_afe.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: trace [--clock 40|80] resistor|capacitance|inductance|esr <value>\n");
+    exit(2);
+}
+
+static void printVcd(char *str)
+{
+    fputs(str, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    CLOCK_PROFILE profile = CLOCK_PROFILE_DEFAULT;
+    SIM_FRONT_END fe = simDefaultFrontEnd();
+    SIM_DUT part = {SIM_DUT_RESISTOR, 0, 0, 0, 0};
+    MEASUREMENT m;
+    const char *method;
+    double value;
+
+    if (argc == 5 && strcmp(argv[1], "--clock") == 0)
+    {
+        profile = (atoi(argv[2]) == 80) ? CLOCK_PROFILE_TURBO : CLOCK_PROFILE_STANDARD;
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 3)
+        usage();
+    method = argv[1];
+    value = atof(argv[2]);
+
+    if (strcmp(method, "resistor") == 0)
+        part.r = value;
+    else if (strcmp(method, "capacitance") == 0)
+    {
+        part.type = SIM_DUT_CAPACITOR;
+        part.c = value;
+        part.esr = 0.1;
+    }
+    else if (strcmp(method, "inductance") == 0)
+    {
+        part.type = SIM_DUT_INDUCTOR;
+        part.l = value;
+        part.r = 0.5;
+    }
+    else if (strcmp(method, "esr") == 0)
+    {
+        part.type = SIM_DUT_INDUCTOR;
+        part.l = 10e-6;
+        part.r = value;
+    }
+    else
+        usage();
+
+    simInit(&fe, &part);
+    initClock(profile);
+    initSerialHw();
+
+    startTrace();
+    if (strcmp(method, "resistor") == 0)
+        m = measureResistance();
+    else if (strcmp(method, "capacitance") == 0)
+        m = measureCapacitance();
+    else if (strcmp(method, "inductance") == 0)
+        m = measureInductance();
+    else
+        m = measureEsr();
+    stopTrace();
+
+    writeTraceVcd(printVcd);
+    fprintf(stderr, "%s %g: value %g status %s, %u events, %u dropped, %.6f s\n",
+            method, value, m.value, getMeasureStatusName(m.status),
+            getTraceCount(), getTraceDropped(), simTime());
+    return 0;
+}
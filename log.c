@@ -0,0 +1,209 @@
+// LCR meter result log
+// Circular log of binary measurement records in SRAM, optionally kept in EEPROM
+
+//-----------------------------------------------------------------------------
+// Storage
+//-----------------------------------------------------------------------------
+
+// SRAM: record n lives in logRecords[n % LOG_CAPACITY].
+// EEPROM: block 0 holds the header (magic, next sequence, check), record n lives
+// in slot n % LOG_EEPROM_RECORDS of blocks 1-31. The header is written last, so a
+// flush cut short by a reset leaves the previous flush readable.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "uart.h"
+#include "hal.h"
+#include "eeprom.h"
+#include "log.h"
+
+#define LOG_EEPROM_MAGIC    0x4C43524C            // "LRCL"
+#define LOG_RECORD_WORDS    (LOG_RECORD_SIZE / 4)
+#define LOG_HEADER_WORDS    3
+
+LOG_RECORD logRecords[LOG_CAPACITY];
+uint32_t logFirstSequence = 0;
+uint32_t logNextSequence = 0;
+uint32_t logFlushedSequence = 0;                    // records below this are in EEPROM
+bool logEepromReady = false;
+bool logAutoFlush = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t getLogRecordCheck(const LOG_RECORD *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    uint8_t check = LOG_CHECK_SEED;
+    uint8_t i;
+
+    for (i = 0; i < LOG_RECORD_SIZE - 1; i++)
+        check ^= bytes[i];
+    return check;
+}
+
+static uint16_t eepromRecordAddress(uint32_t sequence)
+{
+    return EEPROM_WORDS_PER_BLOCK + (sequence % LOG_EEPROM_RECORDS) * LOG_RECORD_WORDS;
+}
+
+void initLog(void)
+{
+    uint32_t header[LOG_HEADER_WORDS];
+    LOG_RECORD record;
+    uint32_t sequence;
+
+    clearLog();
+    logEepromReady = initEeprom();
+    if (!logEepromReady)
+        return;
+
+    readEeprom(0, header, LOG_HEADER_WORDS);
+    if (header[0] != LOG_EEPROM_MAGIC || header[2] != (header[0] ^ header[1]))
+        return;
+
+    logNextSequence = header[1];
+    logFlushedSequence = logNextSequence;
+    logFirstSequence = logNextSequence > LOG_EEPROM_RECORDS ? logNextSequence - LOG_EEPROM_RECORDS : 0;
+
+    // records that fail their check stay out of the RAM ring and are skipped by dump
+    for (sequence = logFirstSequence; sequence < logNextSequence; sequence++)
+    {
+        readEeprom(eepromRecordAddress(sequence), (uint32_t *)&record, LOG_RECORD_WORDS);
+        if (record.sequence == sequence && record.check == getLogRecordCheck(&record))
+            logRecords[sequence % LOG_CAPACITY] = record;
+    }
+}
+
+uint32_t logMeasurement(LOG_TYPE type, uint8_t range, LOG_QUALITY quality, float value)
+{
+    LOG_RECORD *record = &logRecords[logNextSequence % LOG_CAPACITY];
+
+    record->sequence = logNextSequence;
+    record->timestamp_ms = getUptimeUs() / 1000;
+    record->value = value;
+    record->type = type;
+    record->range = range;
+    record->quality = quality;
+    record->check = getLogRecordCheck(record);
+
+    logNextSequence++;
+    if (logNextSequence - logFirstSequence > LOG_CAPACITY)
+        logFirstSequence = logNextSequence - LOG_CAPACITY;
+
+    if (logAutoFlush)
+        flushLog();
+    return record->sequence;
+}
+
+bool getLogRecord(uint32_t sequence, LOG_RECORD *record)
+{
+    const LOG_RECORD *stored = &logRecords[sequence % LOG_CAPACITY];
+
+    if (sequence < logFirstSequence || sequence >= logNextSequence)
+        return false;
+    if (stored->sequence != sequence || stored->check != getLogRecordCheck(stored))
+        return false;
+    *record = *stored;
+    return true;
+}
+
+uint32_t getLogFirstSequence(void)
+{
+    return logFirstSequence;
+}
+
+uint32_t getLogNextSequence(void)
+{
+    return logNextSequence;
+}
+
+uint32_t getLogFlushedSequence(void)
+{
+    return logFlushedSequence;
+}
+
+// Writes the records not yet in EEPROM (at most the newest LOG_EEPROM_RECORDS), then the header
+bool flushLog(void)
+{
+    uint32_t header[LOG_HEADER_WORDS];
+    LOG_RECORD record;
+    uint32_t sequence = logFlushedSequence;
+
+    if (!logEepromReady)
+        return false;
+
+    if (logNextSequence - sequence > LOG_EEPROM_RECORDS)
+        sequence = logNextSequence - LOG_EEPROM_RECORDS;
+    for (; sequence < logNextSequence; sequence++)
+    {
+        if (!getLogRecord(sequence, &record))
+            continue;
+        if (!writeEeprom(eepromRecordAddress(sequence), (uint32_t *)&record, LOG_RECORD_WORDS))
+            return false;
+    }
+
+    header[0] = LOG_EEPROM_MAGIC;
+    header[1] = logNextSequence;
+    header[2] = header[0] ^ header[1];
+    if (!writeEeprom(0, header, LOG_HEADER_WORDS))
+        return false;
+
+    logFlushedSequence = logNextSequence;
+    return true;
+}
+
+void setLogAutoFlush(bool on)
+{
+    logAutoFlush = on;
+    if (on)
+        flushLog();
+}
+
+bool getLogAutoFlush(void)
+{
+    return logAutoFlush;
+}
+
+// Empties the RAM log, the EEPROM copy is dropped on the next flush
+void clearLog(void)
+{
+    memset(logRecords, 0, sizeof(logRecords));
+    logFirstSequence = 0;
+    logNextSequence = 0;
+    logFlushedSequence = 0;
+}
+
+// "log <first> <count> <record size>", the records in binary, then "log end <next>".
+// A host that lost the stream asks again with "dump <next>" to resume.
+void dumpLog(uint32_t sequence)
+{
+    LOG_RECORD record;
+    char line[48];
+    uint32_t count = 0;
+    uint32_t i;
+    uint8_t j;
+
+    if (sequence < logFirstSequence)
+        sequence = logFirstSequence;
+    for (i = sequence; i < logNextSequence; i++)
+        count += getLogRecord(i, &record);
+
+    sprintf(line, "\r\nlog %u %u %u\r\n", sequence, count, LOG_RECORD_SIZE);
+    putsUart0(line);
+    for (i = sequence; i < logNextSequence; i++)
+    {
+        if (!getLogRecord(i, &record))
+            continue;
+        for (j = 0; j < LOG_RECORD_SIZE; j++)
+            putcUart0(((char *)&record)[j]);
+    }
+    sprintf(line, "\r\nlog end %u\r\n", logNextSequence);
+    putsUart0(line);
+}
@@ -0,0 +1,76 @@
+// LCR meter result log
+// Circular log of binary measurement records in SRAM, optionally kept in EEPROM
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define LOG_CAPACITY        256   // records held in SRAM
+#define LOG_RECORD_SIZE     16
+#define LOG_EEPROM_RECORDS  124   // 31 EEPROM blocks of 4 records, block 0 is the header
+
+typedef enum _LOG_TYPE
+{
+    LOG_TYPE_RESISTANCE = 1,      // kilo-ohm
+    LOG_TYPE_CAPACITANCE,         // micro-farad
+    LOG_TYPE_INDUCTANCE,          // micro-henry
+    LOG_TYPE_ESR                  // ohm
+} LOG_TYPE;
+
+typedef enum _LOG_QUALITY
+{
+    LOG_QUALITY_OK = 0,
+    LOG_QUALITY_NO_EDGE,          // comparator never tripped in the window
+    LOG_QUALITY_ABORTED,
+    LOG_QUALITY_OPEN,             // DUT probe stopped the measurement, see MEASURE_STATUS
+    LOG_QUALITY_SHORT,
+    LOG_QUALITY_SATURATED,
+    LOG_QUALITY_TIMEOUT
+} LOG_QUALITY;
+
+// Record as stored and as sent by dump, little endian, LOG_RECORD_SIZE bytes
+typedef struct _LOG_RECORD
+{
+    uint32_t sequence;            // counts up from 0 since the log was cleared
+    uint32_t timestamp_ms;        // uptime when the reading finished
+    float value;
+    uint8_t type;                 // LOG_TYPE
+    uint8_t range;                // calibration range, see MEASUREMENT
+    uint8_t quality;              // LOG_QUALITY
+    uint8_t check;                // xor of the other bytes, seeded with LOG_CHECK_SEED
+} LOG_RECORD;
+
+#define LOG_CHECK_SEED      0x5A
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Restores whatever was flushed to EEPROM before the last reset
+void initLog(void);
+
+uint32_t logMeasurement(LOG_TYPE type, uint8_t range, LOG_QUALITY quality, float value);
+bool getLogRecord(uint32_t sequence, LOG_RECORD *record);
+uint8_t getLogRecordCheck(const LOG_RECORD *record);
+
+// Retained records are first..next-1 (some may be missing after a restore)
+uint32_t getLogFirstSequence(void);
+uint32_t getLogNextSequence(void);
+uint32_t getLogFlushedSequence(void);
+
+// EEPROM holds the newest LOG_EEPROM_RECORDS records
+bool flushLog(void);
+void setLogAutoFlush(bool on);
+bool getLogAutoFlush(void);
+void clearLog(void);
+
+// Streams records from sequence on over UART0, see README.md for the framing
+void dumpLog(uint32_t sequence);
+
+#endif /* LOG_H_ */
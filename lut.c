@@ -0,0 +1,71 @@
+// LCR meter conversion tables
+// Piecewise linear tick count to component value tables, see lut_data.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "lut.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Binary search for the segment, then one multiply and shift per part of the
+// tick position. ticks + fraction / 2^LUT_FRACTION_BITS, value returned with
+// LUT_FRACTION_BITS fraction bits.
+static uint64_t interpolate(const LUT *lut, uint32_t ticks, uint32_t fraction, uint8_t *segment)
+{
+    const LUT_POINT *point;
+    uint64_t value;
+    uint64_t delta;
+    uint32_t whole;
+    uint8_t low = 0;
+    uint8_t high = lut->count - 1;
+    uint8_t middle;
+
+    while (low < high)
+    {
+        middle = (low + high + 1) / 2;
+        if (lut->points[middle].ticks <= ticks)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    point = &lut->points[low];
+    if (segment)
+        *segment = low;
+    value = (uint64_t)point->value << LUT_FRACTION_BITS;
+
+    // below the first breakpoint, extrapolate down the first segment
+    if (ticks < point->ticks)
+    {
+        whole = point->ticks - ticks;
+        delta = (((uint64_t)whole * point->slope) >> (lut->slope_shift - LUT_FRACTION_BITS))
+              - (((uint64_t)fraction * point->slope) >> lut->slope_shift);
+        return delta < value ? value - delta : 0;
+    }
+
+    whole = ticks - point->ticks;
+    delta = (((uint64_t)whole * point->slope) >> (lut->slope_shift - LUT_FRACTION_BITS))
+          + (((uint64_t)fraction * point->slope) >> lut->slope_shift);
+    return value + delta;
+}
+
+uint32_t lutLookup(const LUT *lut, uint32_t ticks, uint8_t *segment)
+{
+    uint64_t value = interpolate(lut, ticks, 0, segment) >> LUT_FRACTION_BITS;
+
+    return value < 0xFFFFFFFF ? (uint32_t)value : 0xFFFFFFFF;
+}
+
+// A capture truncates, so a count stands for the middle of its tick. That point
+// is scaled to the table's tick rate keeping the fraction, then interpolated.
+float lutValue(const LUT *lut, uint32_t ticks, uint32_t ticksPerUs, uint8_t *segment)
+{
+    uint64_t scaled = (((uint64_t)ticks * 2 + 1) * LUT_TICKS_PER_US << LUT_FRACTION_BITS) / (2 * ticksPerUs);
+    return interpolate(lut, (uint32_t)(scaled >> LUT_FRACTION_BITS),
+                       (uint32_t)scaled & ((1 << LUT_FRACTION_BITS) - 1), segment)
+           * (lut->scale / (1 << LUT_FRACTION_BITS));
+}
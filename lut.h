@@ -0,0 +1,55 @@
+// LCR meter conversion tables
+// Piecewise linear tick count to component value tables, see lut_data.c
+
+#ifndef LUT_H_
+#define LUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// Tables are indexed by time in comparator ticks at this rate, a count at any clock
+// is taken at the middle of its tick and scaled to it
+#define LUT_TICKS_PER_US 40
+
+// Fraction bits kept when another clock's ticks are scaled to the table rate, so
+// the finer ticks of a faster clock still count
+#define LUT_FRACTION_BITS 8
+
+// Breakpoint, slope is value units per tick in the table's fixed point
+typedef struct _LUT_POINT
+{
+    uint32_t ticks;
+    uint32_t value;
+    uint32_t slope;
+} LUT_POINT;
+
+typedef struct _LUT
+{
+    const LUT_POINT *points;       // ascending ticks
+    uint8_t count;
+    uint8_t slope_shift;           // fraction bits of slope
+    float scale;                   // value units to the firmware's unit (kilo-ohm, micro-farad, micro-henry)
+} LUT;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Value in table units, ticks beyond either end follow the outer segment.
+// segment (optional) returns the breakpoint the interpolation started from.
+uint32_t lutLookup(const LUT *lut, uint32_t ticks, uint8_t *segment);
+
+// Comparator ticks counted at ticksPerUs to the firmware's unit, the one
+// conversion the meter and the host analyzer share
+float lutValue(const LUT *lut, uint32_t ticks, uint32_t ticksPerUs, uint8_t *segment);
+
+// Generated by host/gen_lut from the front end model and calibration points
+extern const LUT resistanceLut;    // milli-ohm
+extern const LUT capacitanceLut;   // pico-farad
+extern const LUT inductanceLut;    // nano-henry
+
+#endif /* LUT_H_ */
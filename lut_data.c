@@ -0,0 +1,161 @@
+// LCR meter conversion tables
+// Generated by host/gen_lut (8 points per decade), do not edit
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lut.h"
+
+// {ticks at 40 MHz, value, slope}
+
+// resistance in milli-ohm
+static const LUT_POINT resistancePoints[48] =
+{
+    {        81,       1337,  261817567},
+    {       109,       1774,  268931652},
+    {       146,       2367,  270799316},
+    {       195,       3158,  272226429},
+    {       260,       4213,  272789428},
+    {       347,       5627,  272434221},
+    {       462,       7495,  274253521},
+    {       615,       9996,  273621570},
+    {       820,      13339,  273827547},
+    {      1092,      17779,  274117661},
+    {      1455,      23710,  273873405},
+    {      1940,      31627,  273912042},
+    {      2586,      42174,  274056743},
+    {      3447,      56238,  273976077},
+    {      4595,      74985,  273895488},
+    {      6127,      99996,  274023561},
+    {      8169,     133348,  273978361},
+    {     10893,     177832,  273966715},
+    {     14525,     237141,  273986506},
+    {     19368,     316232,  273975658},
+    {     25826,     421692,  273993097},
+    {     34438,     562337,  273976077},
+    {     45923,     749890,  273984908},
+    {     61238,     999996,  273976601},
+    {     81662,    1333526,  273983391},
+    {    108896,    1778275,  273978031},
+    {    145215,    2371378,  273980849},
+    {    193646,    3162282,  273979900},
+    {    258230,    4216969,  273980372},
+    {    344354,    5623417,  273977270},
+    {    459203,    7498938,  273977753},
+    {    612357,    9999996,  273975259},
+    {    816593,   13335210,  273973834},
+    {   1088948,   17782798,  273970864},
+    {   1452142,   23713733,  273967555},
+    {   1936476,   31622781,  273962720},
+    {   2582356,   42169646,  273956356},
+    {   3443672,   56234137,  273947931},
+    {   4592290,   74989425,  273936703},
+    {   6124059,   99999996,  273921611},
+    {   8166819,  133352139,  273901626},
+    {  10891082,  177827937,  273874871},
+    {  14524300,  237137366,  273839380},
+    {  19369902,  316227762,  273791929},
+    {  25832736,  421696499,  273728396},
+    {  34453064,  562341321,  273643940},
+    {  45952004,  749894205,  273804482},
+    {  61277096,  999999996,  273804482},
+};
+
+const LUT resistanceLut = {resistancePoints, 48, 24, 1e-06};
+
+// capacitance in pico-farad
+static const LUT_POINT capacitancePoints[57] =
+{
+    {        60,         10,    2797781},
+    {        80,         13,    2815774},
+    {       107,         18,    2802950},
+    {       142,         24,    2793509},
+    {       190,         32,    2786570},
+    {       253,         42,    2809082},
+    {       337,         56,    2796991},
+    {       450,         75,    2788092},
+    {       600,        100,    2797781},
+    {       800,        133,    2794682},
+    {      1067,        178,    2795076},
+    {      1423,        237,    2796452},
+    {      1898,        316,    2797584},
+    {      2530,        422,    2795768},
+    {      3374,        562,    2795749},
+    {      4500,        750,    2795522},
+    {      6001,       1000,    2796382},
+    {      8002,       1334,    2795729},
+    {     10671,       1778,    2795862},
+    {     14230,       2371,    2795863},
+    {     18976,       3162,    2796037},
+    {     25304,       4217,    2795934},
+    {     33744,       5623,    2795873},
+    {     44998,       7499,    2795895},
+    {     60006,      10000,    2795963},
+    {     80019,      13335,    2795886},
+    {    106708,      17783,    2795940},
+    {    142297,      23714,    2795922},
+    {    189756,      31623,    2795904},
+    {    253044,      42170,    2795934},
+    {    337439,      56234,    2795910},
+    {    449982,      74989,    2795923},
+    {    600061,     100000,    2795921},
+    {    800194,     133352,    2795918},
+    {   1067076,     177828,    2795916},
+    {   1422969,     237137,    2795919},
+    {   1897559,     316228,    2795920},
+    {   2530436,     421697,    2795918},
+    {   3374391,     562341,    2795920},
+    {   4499822,     749894,    2795918},
+    {   6000609,    1000000,    2795920},
+    {   8001940,    1333521,    2795919},
+    {  10670759,    1778279,    2795920},
+    {  14229684,    2371374,    2795919},
+    {  18975590,    3162278,    2795919},
+    {  25304356,    4216965,    2795918},
+    {  33743904,    5623413,    2795919},
+    {  44998220,    7498942,    2795919},
+    {  60006092,   10000000,    2795920},
+    {  80019400,   13335214,    2795919},
+    { 106707584,   17782794,    2795918},
+    { 142296864,   23713737,    2795919},
+    { 189755920,   31622777,    2795920},
+    { 253043568,   42169650,    2795917},
+    { 337439072,   56234132,    2795920},
+    { 449982176,   74989421,    2796220},
+    { 600044736,  100000000,    2796220},
+};
+
+const LUT capacitanceLut = {capacitancePoints, 57, 24, 1e-06};
+
+// inductance in nano-henry
+static const LUT_POINT inductancePoints[27] =
+{
+    {        16,      10152, 2543436867},
+    {        21,      13176, 2664928808},
+    {        28,      17627, 2618545028},
+    {        38,      23872, 2653833296},
+    {        50,      31463, 2681017862},
+    {        67,      42326, 2621809504},
+    {        89,      56078, 2622179374},
+    {       119,      74833, 2622549296},
+    {       159,      99844, 2614748181},
+    {       213,     133508, 2609021211},
+    {       284,     177673, 2604835368},
+    {       380,     237291, 2581549899},
+    {       508,     316074, 2571906670},
+    {       680,     421544, 2553710556},
+    {       911,     562190, 2537592942},
+    {      1221,     749745, 2506618204},
+    {      1640,    1000148, 2475911995},
+    {      2205,    1333667, 2436904201},
+    {      2970,    1778137, 2388495225},
+    {      4012,    2371513, 2331195798},
+    {      5435,    3162412, 2259284715},
+    {      7393,    4217094, 2169573882},
+    {     10112,    5623536, 2059033666},
+    {     13932,    7498828, 1918997015},
+    {     19399,   10000104, 1740454466},
+    {     27436,   13335124, 1507069127},
+    {     39814,   17782704, 1507069127},
+};
+
+const LUT inductanceLut = {inductancePoints, 27, 22, 0.001};
@@ -0,0 +1,770 @@
+// LCR meter measurement engine
+// Drive sequences and conversions, hardware accessed only through hal.h
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "clock.h"
+#include "power.h"
+#include "hal.h"
+#include "lut.h"
+#include "classify.h"
+#include "measure.h"
+
+// ADC full scale
+#define VDDA        3.3
+#define ADC_COUNTS  4096.0
+
+// ESR step capture
+#define ESR_BURST           32      // pairs right after the step, about 1 us apart
+#define ESR_SETTLE_MS       200
+#define ESR_AVERAGE         16      // pairs averaged for a settled reading
+#define ESR_STABLE_COUNTS   1.0     // settled between two 1 ms reads
+#define ESR_FIT_MIN_COUNTS  64      // samples below this are too noisy to fit
+
+// DUT probe ahead of the long sequences
+#define DISCHARGE_MAX_MS    500
+#define DISCHARGED_COUNTS   8       // about 6 mV
+#define MEASURE_VREF        2.469   // comparator reference (ACREFCTL VREF 15, high range)
+#define MEASURE_VIN         3.288721 // DUT1 and high side rail, R and C charge towards it
+#define PROBE_SETTLE_US     1000
+#define PROBE_HIGHSIDE_OHM  100000.0
+#define PROBE_QUIET_VOLTS   0.02
+#define PROBE_STEP_VOLTS    0.5     // only a low resistance or a capacitor steps this high
+#define PROBE_DECAY_FRACTION 0.95   // of the step, still there 1 ms later
+#define PROBE_OPEN_FRACTION 0.995   // of Vin on DUT2 through HIGHSIDE_R, above about 20 Mohm
+#define PROBE_SHORT_OHM     1.0
+#define PROBE_FLAT_FRACTION 0.99    // of the settled DUT2, reached by the first sample
+#define RESISTANCE_MAX_OHM  1000000.0  // charges the integrator past the 1.5 s window
+#define CAPACITANCE_MAX_US  15000000.0 // charge window
+
+// Charge transfer for small capacitors
+#define CHARGE_LEVEL        0           // lowest reference, fewest cycles
+#define CHARGE_CYCLES_MAX   250000      // 0.5 s of cycles, port writes included, about 1.3 pF
+#define CHARGE_CYCLES_MIN   100         // a coarser count than 1 %, about 3.3 nF
+#define CHARGE_EMPTY_US     1000        // integrator through LOWSIDE_R, about 30 time constants
+#define CHARGE_INTEGRATE_PF 1101908.0   // resistance calibration's 1.5309 us per ohm over ln(Vin / (Vin - Vref))
+#define CHARGE_BUDGET_US    (PROBE_BUDGET_US + DISCHARGE_MAX_MS * 1000 + CHARGE_EMPTY_US + CHARGE_CYCLES_MAX * 2 * CHARGE_PHASE_US)
+
+// Deadlines: the waits a measurement asks for, plus time for the conversions and
+// ADC reads in between. The watchdog only fires when the core is stuck past it.
+#define PROBE_BUDGET_US     (2 * DISCHARGE_MAX_MS * 1000 + 2 * PROBE_SETTLE_US)
+#define ESR_BUDGET_US       ((DISCHARGE_MAX_MS + ESR_SETTLE_MS) * 1000)
+#define MEASURE_MARGIN_US   250000
+#define MEASURE_WATCHDOG_US 1000000     // past the deadline
+#define BUDGET_MAX_STEPS    1024        // ops walked for a sequence's budget
+
+typedef struct _ADC_AVERAGE
+{
+    float dut1;
+    float dut2;
+} ADC_AVERAGE;
+
+MEASURE_ABORT_CHECK abortCheck = 0;
+bool measurementAborted = false;
+bool measurementTimedOut = false;
+uint64_t measurementDeadline = 0;
+float chargeZeroPf = 0;             // fixture with nothing connected, see zeroSmallCapacitance
+bool identifiedSmallCapacitor = false;
+float dischargedVolts = 0;          // left across the DUT by the last dischargeDut
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Thresholds one RC charge (R into the integrator, C through HIGHSIDE_R) crosses.
+// The reference takes a few microseconds to settle after each step, so trips
+// closer together than that (below about 10 ohm, 1 nF) lean on the last level.
+static const uint8_t chargeLevels[] = {9, 12, COMPARATOR_LEVEL_DEFAULT};
+
+#define CHARGE_LEVELS (sizeof(chargeLevels) / sizeof(chargeLevels[0]))
+
+// Table lookup at the system clock, range is the breakpoint the interpolation started from
+static float convertTicks(const LUT * lut, uint32_t ticks, uint8_t * range){
+    return lutValue(lut, ticks, getTicksPerUs(), range);
+}
+
+// R charges the 1 uF integrator, resistance in kilo-ohm
+float resistanceFromTicks(uint32_t ticks){
+    return convertTicks(&resistanceLut, ticks, 0);
+}
+
+// C charges through the 100k high side resistor, capacitance in micro-farad
+float capacitanceFromTicks(uint32_t ticks){
+    return convertTicks(&capacitanceLut, ticks, 0);
+}
+
+// L current rises through the 33 ohm low side resistor, inductance in micro-henry
+float inductanceFromTicks(uint32_t ticks){
+    return convertTicks(&inductanceLut, ticks, 0);
+}
+
+// The integrator after n transfers is at Vin * (1 - a^n), a = Cint / (Cint + C).
+// The trip fell between the last two cycles, taken half way. Pico-farad.
+float capacitanceFromTransfers(uint32_t cycles){
+    float vth = MEASURE_VREF * (8 + CHARGE_LEVEL) / (8 + COMPARATOR_LEVEL_DEFAULT);
+    float k = logf(MEASURE_VIN / (MEASURE_VIN - vth));
+
+    return CHARGE_INTEGRATE_PF * expm1f(k / (cycles - 0.5f));
+}
+
+// DC divider of the DUT series resistance against the 33 ohm low side resistor
+float esrFromVoltage(float vin, float vo){
+    return (LOWSIDE_R_OHM * ((vin - vo) / vo));
+}
+
+static float countsToVolts(float counts){
+    return ((counts * VDDA)/ADC_COUNTS);
+}
+
+// Mean of a burst, takes the noise off a settled reading
+static ADC_AVERAGE averageAdcPair(){
+    ADC_PAIR samples[ESR_AVERAGE];
+    ADC_AVERAGE average = {0, 0};
+    uint16_t i;
+
+    readAdcBurst(samples, ESR_AVERAGE);
+    for(i = 0; i < ESR_AVERAGE; i++){
+        average.dut1 += samples[i].dut1;
+        average.dut2 += samples[i].dut2;
+    }
+    average.dut1 /= ESR_AVERAGE;
+    average.dut2 /= ESR_AVERAGE;
+    return average;
+}
+
+// Least squares fit of ln(DUT2) against time over the burst samples clear of the
+// noise floor, DUT2 at the step is the fit at time 0
+static float esrStepVoltage(const ADC_PAIR * samples, uint16_t count){
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    float x, y, slope;
+    uint16_t n = 0;
+    uint16_t i;
+
+    for(i = 0; i < count; i++){
+        if(samples[i].dut2 < ESR_FIT_MIN_COUNTS)
+            continue;
+        x = ticksToMicroseconds(samples[i].ticks);
+        y = logf(samples[i].dut2);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+    if(n < 2 || (n * sxx - sx * sx) <= 0){
+        return countsToVolts(samples[0].dut2);
+    }
+
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    return countsToVolts(expf((sy - slope * sx) / n));
+}
+
+void setMeasureAbortCheck(MEASURE_ABORT_CHECK check){
+    abortCheck = check;
+}
+
+bool wasMeasurementAborted(){
+    return measurementAborted;
+}
+
+// Starts the clock on a measurement that should take budget_us
+static void beginMeasurement(uint32_t budget_us){
+    uint32_t deadline_us = budget_us + MEASURE_MARGIN_US;
+
+    if(budget_us > MEASURE_DEADLINE_MAX_US - MEASURE_MARGIN_US)
+        deadline_us = MEASURE_DEADLINE_MAX_US;
+    measurementAborted = false;
+    measurementTimedOut = false;
+    measurementDeadline = getUptimeUs() + deadline_us;
+    rearmWatchdog();
+    loadWatchdog(deadline_us + MEASURE_WATCHDOG_US);
+}
+
+// Past the deadline, or a wait of us would end past it
+static bool isPastDeadline(uint32_t us){
+    if(getUptimeUs() + us > measurementDeadline){
+        measurementTimedOut = true;
+    }
+    return measurementTimedOut;
+}
+
+// Sleeps through one phase of a sequence, false once the measurement is aborted or
+// the phase can't finish by the deadline. Nothing is gained by sleeping up to the
+// deadline first, so an overrun fails at once.
+static bool measureWait(uint32_t us){
+    if(measurementAborted || isPastDeadline(us)){
+        return false;
+    }
+    measurementAborted = sleepMicrosecondUntil(us, abortCheck);
+    return !measurementAborted;
+}
+
+// Why the measurement stopped early
+static MEASURE_STATUS stoppedStatus(){
+    return measurementTimedOut ? MEASURE_TIMEOUT : MEASURE_ABORTED;
+}
+
+// Leaves the front end safe after an abort or a timeout
+static MEASUREMENT cancelSequence(MEASUREMENT result){
+    stopCapture();
+    resetOutputTerminals();
+    result.status = stoppedStatus();
+    return result;
+}
+
+// Result of a probe that stopped the measurement before it started
+static MEASUREMENT failedSequence(MEASURE_STATUS status){
+    MEASUREMENT result = {0};
+
+    result.status = status;
+    return result;
+}
+
+const char * getMeasureStatusName(MEASURE_STATUS status){
+    switch(status){
+        case MEASURE_OK:        return "ok";
+        case MEASURE_NO_EDGE:   return "no comparator edge";
+        case MEASURE_ABORTED:   return "aborted";
+        case MEASURE_OPEN:      return "open";
+        case MEASURE_SHORT:     return "short";
+        case MEASURE_SATURATED: return "out of range";
+        case MEASURE_TIMEOUT:   return "timed out";
+    }
+    return "unknown";
+}
+
+// Shorts both DUT nodes to ground until the DUT holds no charge, false once aborted.
+// A capacitor charged from DUT1 would pull DUT2 below ground where the ADC can't
+// see it, so DUT1 is let float for each check and reads the capacitor voltage.
+// Everything else goes off first, MEAS_C with MEAS_LR on would short Vdd.
+static bool dischargeDut(){
+    ADC_PAIR discharged;
+    uint16_t i;
+
+    resetOutputTerminals();
+    setTerminal(TERMINAL_MEAS_C | TERMINAL_LOWSIDE_R, true);
+    for(i = 0; i < DISCHARGE_MAX_MS; i++){
+        if(!measureWait(1000)){
+            return false;
+        }
+        setTerminal(TERMINAL_MEAS_C, false);
+        readAdcBurst(&discharged, 1);
+        setTerminal(TERMINAL_MEAS_C, true);
+        if(discharged.dut1 <= DISCHARGED_COUNTS && discharged.dut2 <= DISCHARGED_COUNTS)
+            break;
+    }
+    dischargedVolts = countsToVolts(discharged.dut1 - discharged.dut2);
+    return true;
+}
+
+// DUT1 and DUT2 voltages
+VOLTAGES measureVoltages(){
+    VOLTAGES result;
+    uint16_t Dut1;
+    uint16_t Dut2;
+
+    Dut1 = readAdc0Ss3(); // Dut1
+    Dut2 = readAdc1Ss3(); // Dut2
+
+    result.v1 = countsToVolts(Dut1);
+    result.v2 = countsToVolts(Dut2);
+    result.voltage = result.v2 - result.v1;
+    return result;
+}
+
+// DUT2 through HIGHSIDE_R right after the switch (DUT1 grounded) and settled, then
+// DUT2 stepped onto LOWSIDE_R (DUT1 at Vin) right after the switch and settled.
+// A capacitor shows a step that decays and a high side that rises, an inductor a
+// step that rises, R and shorts are flat.
+typedef struct _DUT_PROBE
+{
+    float vin;
+    float highside;
+    float charged;
+    float step;
+    float lowside;
+} DUT_PROBE;
+
+static bool probeDut(DUT_PROBE * probe){
+    ADC_PAIR sample;
+    ADC_AVERAGE settled;
+
+    resetOutputTerminals();
+    if(!dischargeDut()){
+        return false;
+    }
+    setTerminal(TERMINAL_LOWSIDE_R, false);
+    setTerminal(TERMINAL_HIGHSIDE_R, true);
+    readAdcBurst(&sample, 1);
+    probe->highside = countsToVolts(sample.dut2);
+    if(!measureWait(PROBE_SETTLE_US)){
+        return false;
+    }
+    settled = averageAdcPair();
+    probe->charged = countsToVolts(settled.dut2);
+
+    setTerminal(TERMINAL_HIGHSIDE_R, false);
+    if(!dischargeDut()){
+        return false;
+    }
+    setTerminal(TERMINAL_MEAS_C, false);
+    setTerminal(TERMINAL_MEAS_LR | TERMINAL_LOWSIDE_R, true);
+    readAdcBurst(&sample, 1);
+    probe->step = countsToVolts(sample.dut2);
+    if(!measureWait(PROBE_SETTLE_US)){
+        return false;
+    }
+    settled = averageAdcPair();
+    probe->vin = countsToVolts(settled.dut1);
+    probe->lowside = countsToVolts(settled.dut2);
+
+    resetOutputTerminals();
+    return true;
+}
+
+// Low side step well clear of the noise that falls back while settling
+static bool isDecaying(const DUT_PROBE * probe){
+    return probe->step > PROBE_STEP_VOLTS && probe->lowside < probe->step * PROBE_DECAY_FRACTION;
+}
+
+// Nothing conducts, nor takes charge
+static bool isProbeOpen(const DUT_PROBE * probe){
+    return probe->step <= PROBE_QUIET_VOLTS && probe->lowside <= PROBE_QUIET_VOLTS && probe->highside >= probe->vin * PROBE_OPEN_FRACTION;
+}
+
+// Under PROBE_SHORT_OHM against the low side resistor
+static bool isProbeShort(const DUT_PROBE * probe){
+    return probe->lowside > PROBE_QUIET_VOLTS && LOWSIDE_R_OHM * (probe->vin - probe->lowside) < PROBE_SHORT_OHM * probe->lowside;
+}
+
+// DC path with no decay, on the low side or through HIGHSIDE_R below Vin where the
+// first sample already holds what the divider settles to. Short when it is one,
+// otherwise the resistance holds DUT2 where a capacitor's charge never gets.
+static MEASURE_STATUS checkDcPath(const DUT_PROBE * probe){
+    if(probe->lowside > PROBE_QUIET_VOLTS && probe->lowside >= probe->step * PROBE_FLAT_FRACTION)
+        return isProbeShort(probe) ? MEASURE_SHORT : MEASURE_SATURATED;
+    if(probe->highside > PROBE_QUIET_VOLTS && probe->highside >= probe->charged * PROBE_FLAT_FRACTION && probe->charged < probe->vin * PROBE_OPEN_FRACTION)
+        return MEASURE_SATURATED;
+    return MEASURE_OK;
+}
+
+static MEASURE_STATUS checkResistor(const DUT_PROBE * probe){
+    float ohm;
+
+    if(probe->highside >= probe->vin * PROBE_OPEN_FRACTION)
+        return MEASURE_OPEN;
+    // a capacitor takes a step and then blocks, no DC path
+    if(isDecaying(probe))
+        return MEASURE_OPEN;
+    if(isProbeShort(probe))
+        return MEASURE_SHORT;
+
+    // divider against the 100k high side resistor
+    ohm = PROBE_HIGHSIDE_OHM * probe->highside / (probe->vin - probe->highside);
+    if(ohm > RESISTANCE_MAX_OHM)
+        return MEASURE_SATURATED;
+    return MEASURE_OK;
+}
+
+static MEASURE_STATUS checkCapacitor(const DUT_PROBE * probe){
+    MEASURE_STATUS status;
+    float tau_us;
+
+    // already past the reference when the first sample is taken, nothing to time
+    if(probe->highside >= probe->vin * PROBE_OPEN_FRACTION)
+        return MEASURE_OPEN;
+    if(probe->highside >= MEASURE_VREF)
+        return MEASURE_SATURATED;
+    status = checkDcPath(probe);
+    if(status != MEASURE_OK)
+        return status;
+
+    // decay through the 33 ohm low side resistor gives C, then the charge time through 100k
+    if(probe->lowside > PROBE_QUIET_VOLTS && probe->step > probe->lowside){
+        tau_us = PROBE_SETTLE_US / logf(probe->step / probe->lowside);
+        if(tau_us / LOWSIDE_R_OHM * PROBE_HIGHSIDE_OHM * logf(probe->vin / (probe->vin - MEASURE_VREF)) > CAPACITANCE_MAX_US)
+            return MEASURE_SATURATED;
+    }
+    return MEASURE_OK;
+}
+
+static MEASURE_STATUS checkInductor(const DUT_PROBE * probe){
+    if(probe->lowside <= PROBE_QUIET_VOLTS || isDecaying(probe))
+        return MEASURE_OPEN;
+    if(probe->step >= probe->lowside * PROBE_FLAT_FRACTION)
+        return MEASURE_SHORT;
+    // winding resistance keeps the current below the trip point
+    if(probe->lowside < MEASURE_VREF)
+        return MEASURE_SATURATED;
+    return MEASURE_OK;
+}
+
+// The probe as part of a measurement, under its deadline
+static MEASURE_STATUS probeFor(COMPONENT component){
+    DUT_PROBE probe;
+
+    if(!probeDut(&probe)){
+        stopCapture();
+        resetOutputTerminals();
+        return stoppedStatus();
+    }
+
+    switch(component){
+        case COMPONENT_RESISTOR:
+            return checkResistor(&probe);
+        case COMPONENT_CAPACITOR:
+            return checkCapacitor(&probe);
+        case COMPONENT_INDUCTOR:
+            return checkInductor(&probe);
+        default:
+            break;
+    }
+
+    if(isProbeOpen(&probe))
+        return MEASURE_OPEN;
+    return MEASURE_OK;
+}
+
+MEASURE_STATUS checkDut(COMPONENT component){
+    beginMeasurement(PROBE_BUDGET_US);
+    return probeFor(component);
+}
+
+// One probe: its voltages as classifier features, then the tree's component.
+// The features are filled in even when nothing is connected.
+MEASURE_STATUS identifyComponent(COMPONENT * component, CLASSIFY_VECTOR * features, int16_t * charged){
+    DUT_PROBE probe;
+
+    beginMeasurement(PROBE_BUDGET_US);
+    *component = COMPONENT_UNKNOWN;
+    identifiedSmallCapacitor = false;
+    if(!probeDut(&probe)){
+        stopCapture();
+        resetOutputTerminals();
+        return stoppedStatus();
+    }
+
+    features->value[CLASSIFY_HIGHSIDE] = classifyFeature(probe.highside, probe.vin);
+    features->value[CLASSIFY_STEP] = classifyFeature(probe.step, probe.vin);
+    features->value[CLASSIFY_LOWSIDE] = classifyFeature(probe.lowside, probe.vin);
+    features->value[CLASSIFY_SLOPE] = classifyFeature(probe.lowside - probe.step, probe.vin);
+    *charged = classifyFeature(probe.charged, probe.vin);
+    if(isProbeOpen(&probe))
+        return MEASURE_OPEN;
+
+    // a few comparator ticks, outside what the tree was trained on
+    if(classifySmallCapacitor(features, *charged)){
+        identifiedSmallCapacitor = true;
+        *component = COMPONENT_CAPACITOR;
+        return MEASURE_OK;
+    }
+    *component = (COMPONENT)classifyVector(&componentTree, features);
+    return MEASURE_OK;
+}
+
+bool wasSmallCapacitor(){
+    return identifiedSmallCapacitor;
+}
+
+// Each trip at v is a point t = tau * ln(vin / (vin - v)) on the charge curve. The
+// least squares tau through all of them, at the default reference, is what the
+// conversion tables are indexed by. 0 when nothing tripped.
+static uint32_t chargeTicks(){
+    CAPTURE_EDGE edge;
+    uint16_t seen = 0;
+    float stk = 0, skk = 0;
+    float k, volts;
+
+    while(getCaptureEdge(&edge)){
+        if(seen & (1 << edge.level))
+            continue;
+        seen |= 1 << edge.level;
+        volts = MEASURE_VREF * (8 + edge.level) / (8 + COMPARATOR_LEVEL_DEFAULT);
+        k = logf(MEASURE_VIN / (MEASURE_VIN - volts));
+        stk += edge.ticks * k;
+        skk += k * k;
+    }
+    if(skk <= 0)
+        return 0;
+
+    k = logf(MEASURE_VIN / (MEASURE_VIN - MEASURE_VREF));
+    return (uint32_t)(stk / skk * k + 0.5);
+}
+
+// What a sequence's waits, capture windows and discharges (at their limit) add up
+// to, through its repeats. A sequence too long to walk gets the longest deadline.
+static uint32_t sequenceBudget(const SEQ_OP * ops){
+    uint8_t passes[SEQ_MAX_OPS] = {0};
+    const SEQ_OP * op;
+    uint64_t us = 0;
+    uint16_t steps;
+    uint8_t pc = 0;
+
+    for(steps = 0; ops[pc].code != SEQ_END; steps++){
+        if(steps == BUDGET_MAX_STEPS || us >= MEASURE_DEADLINE_MAX_US)
+            return MEASURE_DEADLINE_MAX_US;
+        op = &ops[pc++];
+        if(op->code == SEQ_WAIT || op->code == SEQ_CAPTURE){
+            us += op->value;
+        }else if(op->code == SEQ_DISCHARGE){
+            us += DISCHARGE_MAX_MS * 1000;
+        }else if(op->code == SEQ_REPEAT){
+            if(++passes[pc - 1] < op->arg){
+                pc = op->value;
+            }else{
+                passes[pc - 1] = 0;
+            }
+        }
+    }
+    return (uint32_t)us;
+}
+
+// Runs a sequence op by op under the deadline beginMeasurement set. Waits sleep on
+// the wake timer and can be aborted. The outputs start off, as isSequenceValid
+// assumes, and are reset at the end either way.
+MEASUREMENT runSequence(const SEQ_OP * ops){
+    MEASUREMENT result = {0};
+    uint8_t passes[SEQ_MAX_OPS] = {0};
+    const SEQ_OP * op;
+    const LUT * table;
+    ADC_AVERAGE sample;
+    uint8_t pc = 0;
+
+    resetOutputTerminals();
+    while(ops[pc].code != SEQ_END){
+        op = &ops[pc++];
+        switch(op->code){
+            case SEQ_RESET:
+                resetOutputTerminals();
+                break;
+            case SEQ_SET:
+                setTerminal(op->arg, true);
+                break;
+            case SEQ_CLEAR:
+                setTerminal(op->arg, false);
+                break;
+            case SEQ_WAIT:
+                if(!measureWait(op->value)){
+                    return cancelSequence(result);
+                }
+                break;
+            case SEQ_DISCHARGE:
+                if(!dischargeDut()){
+                    return cancelSequence(result);
+                }
+                break;
+            case SEQ_CAPTURE:
+                if(op->arg)
+                    setComparatorLevels(chargeLevels, CHARGE_LEVELS);
+                else
+                    setComparatorLevels(0, 0);
+                startCapture();
+                if(!measureWait(op->value)){
+                    return cancelSequence(result);
+                }
+                stopCapture();
+
+                // time in micro seconds
+                result.ticks = op->arg ? chargeTicks() : getCaptureTicks();
+                result.time_us = ticksToMicroseconds(result.ticks);
+                break;
+            case SEQ_CONVERT:
+                if(op->arg == SEQ_TABLE_RESISTANCE)
+                    table = &resistanceLut;
+                else if(op->arg == SEQ_TABLE_CAPACITANCE)
+                    table = &capacitanceLut;
+                else
+                    table = &inductanceLut;
+                result.value = convertTicks(table, result.ticks, &result.range);
+                result.status = result.ticks == 0 ? MEASURE_NO_EDGE : MEASURE_OK;
+                break;
+            case SEQ_SAMPLE:
+                sample = averageAdcPair();
+                result.volts = countsToVolts(sample.dut2);
+                break;
+            case SEQ_REPEAT:
+                // a loop without waits still ends at the deadline
+                if(isPastDeadline(0)){
+                    return cancelSequence(result);
+                }
+                if(++passes[pc - 1] < op->arg){
+                    pc = op->value;
+                }else{
+                    passes[pc - 1] = 0;
+                }
+                break;
+        }
+    }
+
+    // reset the output terminal potentials
+    resetOutputTerminals();
+    return result;
+}
+
+MEASUREMENT measureResistance(){
+    MEASURE_STATUS status;
+
+    beginMeasurement(PROBE_BUDGET_US + sequenceBudget(seqResistance));
+    status = probeFor(COMPONENT_RESISTOR);
+    if(status != MEASURE_OK)
+        return failedSequence(status);
+    return runSequence(seqResistance);
+}
+
+MEASUREMENT measureCapacitance(){
+    MEASURE_STATUS status;
+
+    beginMeasurement(PROBE_BUDGET_US + sequenceBudget(seqCapacitance));
+    status = probeFor(COMPONENT_CAPACITOR);
+    if(status != MEASURE_OK)
+        return failedSequence(status);
+    return runSequence(seqCapacitance);
+}
+
+MEASUREMENT measureInductance(){
+    MEASURE_STATUS status;
+
+    beginMeasurement(PROBE_BUDGET_US + sequenceBudget(seqInductance));
+    status = probeFor(COMPONENT_INDUCTOR);
+    if(status != MEASURE_OK)
+        return failedSequence(status);
+    return runSequence(seqInductance);
+}
+
+// Uploaded sequences run as they are, without a DUT check
+MEASUREMENT measureSequence(const SEQ_OP * ops){
+    beginMeasurement(sequenceBudget(ops));
+    return runSequence(ops);
+}
+
+// Discharge until both DUT nodes are back at ground, then step the DUT onto the
+// low side resistor. A capacitor's current decays, so its ESR only shows in the
+// step and the burst is extrapolated back to the switch. Anything else is read
+// once DUT2 has settled.
+MEASUREMENT measureEsr(){
+    MEASUREMENT result = {0};
+    ADC_PAIR burst[ESR_BURST];
+    ADC_AVERAGE settled;
+    MEASURE_STATUS status;
+    float previous;
+    uint16_t i;
+    float vin;
+
+    beginMeasurement(PROBE_BUDGET_US + ESR_BUDGET_US);
+
+    // a capacitor still shows a step
+    status = probeFor(COMPONENT_UNKNOWN);
+    if(status == MEASURE_OPEN || status == MEASURE_ABORTED || status == MEASURE_TIMEOUT)
+        return failedSequence(status);
+
+    // Reset output terminals to 0v
+    resetOutputTerminals();
+
+    // discharge capacitor
+    if(!dischargeDut()){
+        return cancelSequence(result);
+    }
+
+    setTerminal(TERMINAL_MEAS_C, false);
+    setTerminal(TERMINAL_MEAS_LR | TERMINAL_LOWSIDE_R, true);
+    readAdcBurst(burst, ESR_BURST);
+
+    previous = burst[ESR_BURST - 1].dut2;
+    for(i = 0; i < ESR_SETTLE_MS; i++){
+        if(!measureWait(1000)){
+            return cancelSequence(result);
+        }
+        settled = averageAdcPair();
+        if(fabsf(settled.dut2 - previous) <= ESR_STABLE_COUNTS)
+            break;
+        previous = settled.dut2;
+    }
+
+    // what the capacitor kept from the discharge opposes Vin, a few mV are
+    // several percent of the small drop across the ESR
+    if(settled.dut2 * 2 < burst[0].dut2){
+        vin = countsToVolts(burst[0].dut1) - dischargedVolts;
+        result.volts = esrStepVoltage(burst, ESR_BURST);
+    }else{
+        vin = countsToVolts(settled.dut1);
+        result.volts = countsToVolts(settled.dut2);
+    }
+    result.value = esrFromVoltage(vin, result.volts);
+
+    // no current left to divide, more series resistance than the divider resolves
+    if(result.volts <= PROBE_QUIET_VOLTS){
+        result.value = 0;
+        result.status = MEASURE_SATURATED;
+    }
+
+    // reset the output terminal potentials
+    resetOutputTerminals();
+    return result;
+}
+
+// Probe for a DC path, then discharge the DUT and empty the integrator and count
+// charge transfers. These parts charge through HIGHSIDE_R before the first sample
+// and look open to the other checks. Nothing ever tripping is reported as open,
+// too few cycles as out of range for this method.
+static MEASUREMENT countCharge(){
+    MEASUREMENT result = {0};
+    DUT_PROBE probe;
+    uint32_t cycles;
+
+    beginMeasurement(CHARGE_BUDGET_US);
+    if(!probeDut(&probe)){
+        return cancelSequence(result);
+    }
+    result.status = checkDcPath(&probe);
+    if(result.status != MEASURE_OK){
+        return result;
+    }
+    resetOutputTerminals();
+    if(!dischargeDut()){
+        return cancelSequence(result);
+    }
+    setTerminal(TERMINAL_INTEGRATE, true);
+    if(!measureWait(CHARGE_EMPTY_US)){
+        return cancelSequence(result);
+    }
+    resetOutputTerminals();
+
+    cycles = countChargeTransfers(CHARGE_LEVEL, CHARGE_CYCLES_MAX);
+    result.ticks = cycles;
+    result.time_us = cycles * 2.0f * CHARGE_PHASE_US;
+    if(cycles == 0){
+        result.status = MEASURE_OPEN;
+    }else if(cycles < CHARGE_CYCLES_MIN){
+        result.status = MEASURE_SATURATED;
+    }else{
+        result.value = capacitanceFromTransfers(cycles);
+    }
+    return result;
+}
+
+MEASUREMENT measureSmallCapacitance(){
+    MEASUREMENT result = countCharge();
+
+    if(result.status == MEASURE_OK){
+        result.value = (result.value - chargeZeroPf) * 1e-6f;
+    }
+    return result;
+}
+
+// An open fixture that never trips has nothing to take off
+MEASUREMENT zeroSmallCapacitance(){
+    MEASUREMENT result = countCharge();
+
+    if(result.status == MEASURE_OPEN){
+        result.status = MEASURE_OK;
+    }
+    if(result.status == MEASURE_OK){
+        chargeZeroPf = result.value;
+        result.value *= 1e-6f;
+    }
+    return result;
+}
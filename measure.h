@@ -0,0 +1,103 @@
+// LCR meter measurement engine
+// Drive sequences and conversions, hardware accessed only through hal.h
+
+#ifndef MEASURE_H_
+#define MEASURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sequence.h"
+#include "classify.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// Why a measurement has no value, same order as LOG_QUALITY
+typedef enum _MEASURE_STATUS
+{
+    MEASURE_OK = 0,
+    MEASURE_NO_EDGE,   // the comparator never tripped in the window
+    MEASURE_ABORTED,
+    MEASURE_OPEN,      // nothing (or too little) between DUT1 and DUT2
+    MEASURE_SHORT,     // DUT1 and DUT2 connected with no R, C or L to time
+    MEASURE_SATURATED, // the part would not trip the comparator within the window
+    MEASURE_TIMEOUT    // ran past its deadline, see MEASURE_DEADLINE_MAX_US
+} MEASURE_STATUS;
+
+// Every measurement has a deadline: its sequence's waits plus a margin, never more
+// than this. The watchdog is loaded a little past it.
+#define MEASURE_DEADLINE_MAX_US  50000000
+
+typedef struct _MEASUREMENT
+{
+    uint32_t ticks;    // comparator capture, system clock ticks; charge transfers for small C
+    float time_us;     // ticks in microseconds
+    float volts;       // DUT2 voltage where the method reads one (ESR)
+    float value;       // kilo-ohm, micro-farad, micro-henry or ohm
+    uint8_t range;     // conversion table segment the value was interpolated in
+    MEASURE_STATUS status;
+} MEASUREMENT;
+
+typedef struct _VOLTAGES
+{
+    float v1;          // DUT1
+    float v2;          // DUT2
+    float voltage;     // v2 - v1
+} VOLTAGES;
+
+typedef enum _COMPONENT
+{
+    COMPONENT_UNKNOWN = 0,
+    COMPONENT_RESISTOR,
+    COMPONENT_CAPACITOR,
+    COMPONENT_INDUCTOR
+} COMPONENT;
+
+// Polled while a measurement waits, returning true cancels it with the outputs reset
+typedef bool (*MEASURE_ABORT_CHECK)(void);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void setMeasureAbortCheck(MEASURE_ABORT_CHECK check);
+bool wasMeasurementAborted();
+const char * getMeasureStatusName(MEASURE_STATUS status);
+
+// Millisecond probe for what the component's measurement can't handle,
+// COMPONENT_UNKNOWN only checks that something is connected
+MEASURE_STATUS checkDut(COMPONENT component);
+
+// Conversions from comparator ticks (system clock) to component values, see lut.h
+float resistanceFromTicks(uint32_t ticks);
+float capacitanceFromTicks(uint32_t ticks);
+float inductanceFromTicks(uint32_t ticks);
+float esrFromVoltage(float vin, float vo);
+float capacitanceFromTransfers(uint32_t cycles);    // pico-farad
+
+// Drive sequence interpreter, see sequence.h; measureSequence runs one under its
+// own deadline
+MEASUREMENT runSequence(const SEQ_OP * ops);
+
+VOLTAGES measureVoltages();
+MEASUREMENT measureResistance();
+MEASUREMENT measureCapacitance();
+MEASUREMENT measureInductance();
+MEASUREMENT measureSequence(const SEQ_OP * ops);
+MEASUREMENT measureEsr();
+
+// Charge transfer (countChargeTransfers) for capacitors below about 3 nF, in
+// micro-farad less the fixture's own capacitance. zeroSmallCapacitance measures
+// that with nothing connected and keeps it until reset.
+MEASUREMENT measureSmallCapacitance();
+MEASUREMENT zeroSmallCapacitance();
+
+// Millisecond probe classified by the decision tree (classify.h) for the auto
+// command, MEASURE_OPEN when nothing is connected. charged is the settled high
+// side for classifySmallCapacitor, which goes ahead of the tree; wasSmallCapacitor
+// tells when the capacitor found is for measureSmallCapacitance.
+MEASURE_STATUS identifyComponent(COMPONENT * component, CLASSIFY_VECTOR * features, int16_t * charged);
+bool wasSmallCapacitor();
+
+#endif /* MEASURE_H_ */
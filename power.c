@@ -0,0 +1,246 @@
+// LCR meter power manager
+// Clock gating, sleep/deep-sleep idle and wake restore time bookkeeping
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    see clock.c (run), PIOSC 16 MHz (deep-sleep)
+
+// Hardware configuration:
+// Timer 1A:
+//   32-bit one-shot used to wake the core from sleepMicrosecond
+// SysTick:
+//   Free-running 24-bit counter used to time the wake restore path
+// UART0:
+//   RX/RX-timeout interrupts (see uart.c) wake the core
+// Watchdog 0:
+//   counts through measurement waits, stopped while idle waits for the host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "uart.h"
+#include "power.h"
+#include "hal.h"
+#include "record.h"
+
+// waits shorter than this are not worth the timer setup, spin instead
+#define SLEEP_MIN_US        1000
+
+// SysTick is used as a down counter over its full 24-bit range
+#define SYSTICK_RELOAD      0x00FFFFFF
+
+POWER_MODE powerMode = POWER_MODE_SLEEP;
+volatile bool timer1Expired = false;
+
+uint32_t wakeCount = 0;
+uint32_t lastWakeRestore = 0;
+uint32_t maxWakeRestore = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Configure clock gating, wake sources and the wake timer (call after initSerialHw)
+void initPower(void)
+{
+    // Peripherals that keep their clock while the core sleeps
+    SYSCTL_SCGCUART_R = SYSCTL_SCGCUART_S0;
+    SYSCTL_SCGCGPIO_R = SYSCTL_SCGCGPIO_S0 | SYSCTL_SCGCGPIO_S2 | SYSCTL_SCGCGPIO_S3 | SYSCTL_SCGCGPIO_S4;
+    SYSCTL_SCGCACMP_R = SYSCTL_SCGCACMP_S0;
+    SYSCTL_SCGCWTIMER_R = SYSCTL_SCGCWTIMER_S5 | SYSCTL_SCGCWTIMER_S4; // comparator timestamps and uptime keep counting
+    SYSCTL_SCGCTIMER_R = SYSCTL_SCGCTIMER_S1;        // wake timer
+    SYSCTL_SCGCADC_R = 0;
+    SYSCTL_SCGCWD_R = SYSCTL_SCGCWD_S0;              // measurement deadlines keep counting
+
+    // Deep-sleep only needs to hear the UART
+    SYSCTL_DCGCUART_R = SYSCTL_DCGCUART_D0;
+    SYSCTL_DCGCGPIO_R = SYSCTL_DCGCGPIO_D0;
+    SYSCTL_DCGCACMP_R = 0;
+    SYSCTL_DCGCWTIMER_R = SYSCTL_DCGCWTIMER_D4;      // uptime, on PIOSC
+    SYSCTL_DCGCTIMER_R = 0;
+    SYSCTL_DCGCADC_R = 0;
+    SYSCTL_DCGCWD_R = 0;
+    SYSCTL_DSLPCLKCFG_R = SYSCTL_DSLPCLKCFG_O_IOSC;   // PIOSC, PLL and MOSC off in deep-sleep
+
+    // Use SCGC/DCGC instead of RCGC while sleeping
+    SYSCTL_RCC_R |= SYSCTL_RCC_ACG;
+
+    // Timer 1A as 32-bit one-shot wake timer
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;
+    TIMER1_CFG_R = TIMER_CFG_32_BIT_TIMER;
+    TIMER1_TAMR_R = TIMER_TAMR_TAMR_1_SHOT;
+    TIMER1_IMR_R = TIMER_IMR_TATOIM;
+    NVIC_EN0_R |= 1 << (INT_TIMER1A-16);             // turn-on interrupt 37 (TIMER1A)
+
+    // SysTick free-running on the system clock for the wake restore time
+    NVIC_ST_CTRL_R = 0;
+    NVIC_ST_RELOAD_R = SYSTICK_RELOAD;
+    NVIC_ST_CURRENT_R = 0;
+    NVIC_ST_CTRL_R = NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_ENABLE;
+
+    setPowerMode(powerMode);
+}
+
+void setPowerMode(POWER_MODE mode)
+{
+    setUart0ClockSource(mode == POWER_MODE_DEEP_SLEEP);
+    powerMode = mode;
+}
+
+POWER_MODE getPowerMode(void)
+{
+    return powerMode;
+}
+
+const char * getPowerModeName(POWER_MODE mode)
+{
+    switch (mode)
+    {
+        case POWER_MODE_RUN:        return "run";
+        case POWER_MODE_SLEEP:      return "sleep";
+        case POWER_MODE_DEEP_SLEEP: return "deep";
+    }
+    return "unknown";
+}
+
+// Bring the clock tree and the ADCs back and take the first reading
+static void powerWake(void)
+{
+    uint32_t restore;
+
+    NVIC_ST_CURRENT_R = 0;                           // restart SysTick at the reload value
+
+    // Run mode clock returns by itself on wake, but the PLL has to relock after deep-sleep
+    while (!(SYSCTL_PLLSTAT_R & SYSCTL_PLLSTAT_LOCK));
+
+    // Un-gate the ADCs and wait until they are ready
+    SYSCTL_RCGCADC_R |= 0x03;
+    while ((SYSCTL_PRADC_R & 0x03) != 0x03);
+
+    // First reading, also settles the sample and hold after the clock was gated
+    ADC0_PSSI_R |= ADC_PSSI_SS3;
+    while (ADC0_ACTSS_R & ADC_ACTSS_BUSY);
+    (void)ADC0_SSFIFO3_R;
+
+    restore = (SYSTICK_RELOAD - NVIC_ST_CURRENT_R) / getTicksPerUs();
+    lastWakeRestore = restore;
+    if (restore > maxWakeRestore)
+        maxWakeRestore = restore;
+    wakeCount++;
+}
+
+// Sleep until UART0 has received data. Waiting for the host is no deadline, the
+// watchdog is fed here and its clock is gated while asleep.
+void powerIdle(void)
+{
+    feedWatchdog();
+    if (powerMode == POWER_MODE_RUN)
+        return;
+
+    // Interrupts stay masked: WFI still wakes on a pending interrupt, which closes
+    // the race between the caller's receive buffer check and going to sleep
+    __asm(" CPSID I");
+    if (!kbhitUart0())
+    {
+        SYSCTL_RCGCADC_R &= ~0x03;                   // ADCs are only needed for measurements
+        SYSCTL_SCGCWD_R = 0;
+        if (powerMode == POWER_MODE_DEEP_SLEEP)
+            NVIC_SYS_CTRL_R |= NVIC_SYS_CTRL_SLEEPDEEP;
+        __asm(" WFI");
+        NVIC_SYS_CTRL_R &= ~NVIC_SYS_CTRL_SLEEPDEEP;
+        SYSCTL_SCGCWD_R = SYSCTL_SCGCWD_S0;
+        feedWatchdog();
+        powerWake();
+    }
+    __asm(" CPSIE I");
+}
+
+// Approximate waiting (in units of microseconds) with the core asleep in between interrupts
+void sleepMicrosecond(uint32_t us)
+{
+    sleepMicrosecondUntil(us, 0);
+}
+
+static bool sleepUntil(uint32_t us, bool (*stop)(void))
+{
+    bool stopped = false;
+    uint32_t step;
+
+    if (powerMode == POWER_MODE_RUN || us < SLEEP_MIN_US)
+    {
+        while (us > 0 && !stopped)
+        {
+            step = us < SLEEP_MIN_US ? us : SLEEP_MIN_US;
+            waitMicrosecond(step);
+            us -= step;
+            stopped = stop && stop();
+        }
+        return stopped;
+    }
+
+    timer1Expired = false;
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;
+    TIMER1_TAILR_R = microsecondsToTicks(us) - 1;
+    TIMER1_ICR_R = TIMER_ICR_TATOCINT;
+    TIMER1_CTL_R |= TIMER_CTL_TAEN;
+
+    // Comparator interrupts are serviced as they arrive, then the core goes back to sleep
+    __asm(" CPSID I");
+    while (!timer1Expired)
+    {
+        __asm(" WFI");
+        __asm(" CPSIE I");
+        if (stop && stop())
+        {
+            stopped = true;
+            TIMER1_CTL_R &= ~TIMER_CTL_TAEN;
+            break;
+        }
+        __asm(" CPSID I");
+    }
+    __asm(" CPSIE I");
+    return stopped;
+}
+
+// As sleepMicrosecond, but stop() is checked after every wake (every millisecond when
+// spinning) and ends the wait early when it returns true. Returns true if stopped.
+// Abortable waits are recorded, a replay has to stop where the meter stopped.
+bool sleepMicrosecondUntil(uint32_t us, bool (*stop)(void))
+{
+    bool stopped = sleepUntil(us, stop);
+
+    if (stop)
+        recordInput(RECORD_WAIT, 0, 0, 0, stopped);
+    return stopped;
+}
+
+uint32_t getWakeCount(void)
+{
+    return wakeCount;
+}
+
+uint32_t getLastWakeRestoreUs(void)
+{
+    return lastWakeRestore;
+}
+
+uint32_t getMaxWakeRestoreUs(void)
+{
+    return maxWakeRestore;
+}
+
+// Wake timer for sleepMicrosecond
+void timer1Isr(void)
+{
+    timer1Expired = true;
+    TIMER1_ICR_R = TIMER_ICR_TATOCINT;
+}
@@ -0,0 +1,47 @@
+// LCR meter power manager
+// Clock gating, sleep/deep-sleep idle and wake restore time bookkeeping
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+// Idle behaviour while the firmware waits for UART RX or a timer/comparator event
+typedef enum _POWER_MODE
+{
+    POWER_MODE_RUN = 0,      // spin, legacy behaviour
+    POWER_MODE_SLEEP,        // WFI with sleep-mode clock gating (SCGC)
+    POWER_MODE_DEEP_SLEEP    // deep-sleep on PIOSC with deep-sleep clock gating (DCGC)
+} POWER_MODE;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initPower(void);
+void setPowerMode(POWER_MODE mode);
+POWER_MODE getPowerMode(void);
+const char * getPowerModeName(POWER_MODE mode);
+
+// Called from polling loops; sleeps until UART0 RX has data
+void powerIdle(void);
+
+// Interrupt driven replacement for long busy waits (keeps comparator and timers running)
+void sleepMicrosecond(uint32_t us);
+bool sleepMicrosecondUntil(uint32_t us, bool (*stop)(void));
+
+// Wake statistics. The restore time runs from WFI exit to the first ADC reading; the
+// wake from sleep before it and the wake interrupt taken after it are not counted
+uint32_t getWakeCount(void);
+uint32_t getLastWakeRestoreUs(void);
+uint32_t getMaxWakeRestoreUs(void);
+
+// Interrupt service routines (vector table)
+void timer1Isr(void);
+
+#endif /* POWER_H_ */
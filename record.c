@@ -0,0 +1,143 @@
+// LCR meter input recording
+// Records every input the measurement engine reads during one command, so the
+// reading can be replayed through the same code on a PC (host/replay)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "clock.h"
+#include "record.h"
+
+RECORD_EVENT recordEvents[RECORD_DEPTH];
+uint16_t recordCount = 0;
+uint32_t recordDropped = 0;
+uint32_t recordTicksPerUs = 40;
+char recordCommand[RECORD_COMMAND_LENGTH + 1] = "";
+char recordPending[RECORD_COMMAND_LENGTH + 1] = "";
+bool recordArmed = false;
+bool recordStarted = false;      // the pending command has read an input
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void setRecordArmed(bool on)
+{
+    recordArmed = on;
+    recordStarted = false;
+}
+
+bool isRecordArmed(void)
+{
+    return recordArmed;
+}
+
+void beginRecordCommand(const char * text)
+{
+    strncpy(recordPending, text, RECORD_COMMAND_LENGTH);
+    recordPending[RECORD_COMMAND_LENGTH] = 0;
+    recordStarted = false;
+}
+
+// Kept short, it runs after every ADC conversion the engine reads
+void recordInput(RECORD_TYPE type, uint32_t ticks, int16_t dut1, int16_t dut2, uint8_t level)
+{
+    RECORD_EVENT * event;
+
+    if (!recordArmed)
+        return;
+    if (!recordStarted)
+    {
+        memcpy(recordCommand, recordPending, sizeof(recordCommand));
+        recordTicksPerUs = getTicksPerUs();
+        recordCount = 0;
+        recordDropped = 0;
+        recordStarted = true;
+    }
+    if (recordCount >= RECORD_DEPTH)
+    {
+        recordDropped++;
+        return;
+    }
+    event = &recordEvents[recordCount++];
+    event->ticks = ticks;
+    event->dut1 = dut1;
+    event->dut2 = dut2;
+    event->type = type;
+    event->level = level;
+}
+
+uint16_t getRecordCount(void)
+{
+    return recordCount;
+}
+
+uint32_t getRecordDropped(void)
+{
+    return recordDropped;
+}
+
+const RECORD_EVENT * getRecordEvent(uint16_t index)
+{
+    return index < recordCount ? &recordEvents[index] : 0;
+}
+
+const char * getRecordCommand(void)
+{
+    return recordCommand;
+}
+
+uint32_t getRecordTicksPerUs(void)
+{
+    return recordTicksPerUs;
+}
+
+void writeRecord(RECORD_PRINT print)
+{
+    char line[48];
+    const RECORD_EVENT * event;
+    uint16_t i;
+
+    sprintf(line, "recording %u %u %u ", recordTicksPerUs, recordCount, recordDropped);
+    print(line);
+    print(recordCommand);
+    print("\r\n");
+
+    for (i = 0; i < recordCount; i++)
+    {
+        event = &recordEvents[i];
+        switch (event->type)
+        {
+            case RECORD_ADC0:
+                sprintf(line, "a %d\r\n", event->dut1);
+                break;
+            case RECORD_ADC1:
+                sprintf(line, "b %d\r\n", event->dut2);
+                break;
+            case RECORD_PAIR:
+                sprintf(line, "p %d %d %u\r\n", event->dut1, event->dut2, event->ticks);
+                break;
+            case RECORD_CAPTURE:
+                sprintf(line, "t %u\r\n", event->ticks);
+                break;
+            case RECORD_EDGE:
+                sprintf(line, "e %u %u\r\n", event->ticks, event->level);
+                break;
+            case RECORD_NO_EDGE:
+                sprintf(line, "n\r\n");
+                break;
+            case RECORD_CHARGE:
+                sprintf(line, "q %u %u\r\n", event->ticks, event->level);
+                break;
+            default:
+                sprintf(line, "w %u\r\n", event->level);
+                break;
+        }
+        print(line);
+    }
+    print("recording end\r\n");
+}
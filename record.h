@@ -0,0 +1,67 @@
+// LCR meter input recording
+// Records every input the measurement engine reads during one command, so the
+// reading can be replayed through the same code on a PC (host/replay)
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define RECORD_DEPTH        384   // events, later ones are counted as dropped
+#define RECORD_COMMAND_LENGTH 80  // as COMMAND_LINE_LENGTH
+
+// Event types are the letters of the dump lines
+typedef enum _RECORD_TYPE
+{
+    RECORD_ADC0 = 'a',            // readAdc0Ss3: dut1
+    RECORD_ADC1 = 'b',            // readAdc1Ss3: dut2
+    RECORD_PAIR = 'p',            // one readAdcBurst pair: dut1, dut2, ticks
+    RECORD_CAPTURE = 't',         // getCaptureTicks: ticks
+    RECORD_EDGE = 'e',            // getCaptureEdge: ticks, level
+    RECORD_NO_EDGE = 'n',         // getCaptureEdge with the queue empty
+    RECORD_CHARGE = 'q',          // countChargeTransfers: cycles in ticks, level
+    RECORD_WAIT = 'w'             // abortable sleepMicrosecondUntil: level 1 if stopped
+} RECORD_TYPE;
+
+typedef struct _RECORD_EVENT
+{
+    uint32_t ticks;
+    int16_t dut1;
+    int16_t dut2;
+    uint8_t type;                 // RECORD_TYPE
+    uint8_t level;
+} RECORD_EVENT;
+
+// Export sink, putsUart0 on target and stdout on the host
+typedef void (*RECORD_PRINT)(char *str);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void setRecordArmed(bool on);
+bool isRecordArmed(void);
+
+// Called before each command. The first input the command reads starts a new
+// recording, so commands that read none keep the previous one.
+void beginRecordCommand(const char * text);
+
+// Called by the hal after every input the engine reads
+void recordInput(RECORD_TYPE type, uint32_t ticks, int16_t dut1, int16_t dut2, uint8_t level);
+
+uint16_t getRecordCount(void);
+uint32_t getRecordDropped(void);
+const RECORD_EVENT * getRecordEvent(uint16_t index);
+const char * getRecordCommand(void);
+uint32_t getRecordTicksPerUs(void);
+
+// "recording <ticks per us> <events> <dropped> <command>", one line per event
+// (see RECORD_TYPE), then "recording end"
+void writeRecord(RECORD_PRINT print);
+
+#endif /* RECORD_H_ */
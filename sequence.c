@@ -0,0 +1,270 @@
+// LCR meter measurement sequences
+// Drive sequences as op tables: built-in ones in flash, user ones uploaded over UART
+
+//-----------------------------------------------------------------------------
+// Format
+//-----------------------------------------------------------------------------
+
+// A sequence is a SEQ_OP table ending in SEQ_END, run by runSequence (measure.c).
+// User slot n takes words 64n..64n+63 of the user flash page (hal.h): a header
+// (SEQ_SLOT_MAGIC | op count, sum of the op words), then the ops.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hal.h"
+#include "sequence.h"
+
+#define SEQ_SLOT_MAGIC      0x53455100              // "SEQ" and the op count
+#define SEQ_SLOT_WORDS      64
+#define SEQ_HEADER_WORDS    2
+#define SEQ_OP_WORDS        (sizeof(SEQ_OP) / 4)
+
+#define OP(code, arg, value)    {code, arg, 0, value}
+
+// DUT1 to Vdd and to ground at once
+#define SEQ_SHOOT_THROUGH   (TERMINAL_MEAS_LR | TERMINAL_MEAS_C)
+
+// Same phases as the original hand-coded sequences
+const SEQ_OP seqResistance[] =
+{
+    OP(SEQ_RESET, 0, 0),
+    OP(SEQ_WAIT, 0, 60000),
+    OP(SEQ_CLEAR, TERMINAL_MEAS_LR, 0),                       // discharge the integrator
+    OP(SEQ_SET, TERMINAL_LOWSIDE_R | TERMINAL_INTEGRATE, 0),
+    OP(SEQ_WAIT, 0, 400000),
+    OP(SEQ_CLEAR, TERMINAL_LOWSIDE_R, 0),                     // charge it through R
+    OP(SEQ_SET, TERMINAL_MEAS_LR, 0),
+    OP(SEQ_CAPTURE, 1, 1500000),
+    OP(SEQ_CONVERT, SEQ_TABLE_RESISTANCE, 0),
+    OP(SEQ_END, 0, 0)
+};
+
+const SEQ_OP seqCapacitance[] =
+{
+    OP(SEQ_RESET, 0, 0),
+    OP(SEQ_SET, TERMINAL_MEAS_C | TERMINAL_LOWSIDE_R, 0),     // discharge
+    OP(SEQ_WAIT, 0, 15000000),
+    OP(SEQ_CLEAR, TERMINAL_LOWSIDE_R, 0),                     // charge through 100k
+    OP(SEQ_SET, TERMINAL_HIGHSIDE_R, 0),
+    OP(SEQ_CAPTURE, 1, 15000000),
+    OP(SEQ_CONVERT, SEQ_TABLE_CAPACITANCE, 0),
+    OP(SEQ_END, 0, 0)
+};
+
+const SEQ_OP seqInductance[] =
+{
+    OP(SEQ_RESET, 0, 0),
+    OP(SEQ_SET, TERMINAL_MEAS_C | TERMINAL_LOWSIDE_R, 0),     // short the DUT
+    OP(SEQ_WAIT, 0, 4000000),
+    OP(SEQ_CLEAR, TERMINAL_MEAS_C, 0),                        // current rises through 33 ohm
+    OP(SEQ_SET, TERMINAL_MEAS_LR | TERMINAL_LOWSIDE_R, 0),
+    OP(SEQ_CAPTURE, 0, 2000000),
+    OP(SEQ_CONVERT, SEQ_TABLE_INDUCTANCE, 0),
+    OP(SEQ_END, 0, 0)
+};
+
+static const char * const opNames[SEQ_CODES] =
+{
+    "end", "reset", "set", "clear", "wait", "discharge", "capture", "convert", "sample", "repeat"
+};
+
+SEQ_OP sequenceEdit[SEQ_MAX_OPS];
+uint8_t sequenceEditCount = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char * getSequenceOpName(uint8_t code)
+{
+    return code < SEQ_CODES ? opNames[code] : "?";
+}
+
+// Adds the terminals an op may leave on to what may be on before op next, true
+// when that grew
+static bool mergeTerminals(uint8_t *on, uint8_t next, uint8_t terminals)
+{
+    if ((on[next] | terminals) == on[next])
+        return false;
+    on[next] |= terminals;
+    return true;
+}
+
+// Walks the terminals each op may leave on, from all off and through every pass of
+// the repeats, until nothing changes. False when MEAS_LR and MEAS_C could both be
+// on after any op; SEQ_DISCHARGE switches everything else off first.
+static bool isShootThroughFree(const SEQ_OP *ops, uint8_t count)
+{
+    uint8_t on[SEQ_MAX_OPS] = {0};      // may be on before each op
+    uint8_t terminals;
+    bool changed = true;
+    uint8_t i;
+
+    while (changed)
+    {
+        changed = false;
+        for (i = 0; i < count - 1; i++)
+        {
+            switch (ops[i].code)
+            {
+                case SEQ_RESET:
+                    terminals = 0;
+                    break;
+                case SEQ_SET:
+                    terminals = on[i] | ops[i].arg;
+                    break;
+                case SEQ_CLEAR:
+                    terminals = on[i] & ~ops[i].arg;
+                    break;
+                case SEQ_DISCHARGE:
+                    terminals = TERMINAL_MEAS_C | TERMINAL_LOWSIDE_R;
+                    break;
+                default:
+                    terminals = on[i];
+                    break;
+            }
+            if ((terminals & SEQ_SHOOT_THROUGH) == SEQ_SHOOT_THROUGH)
+                return false;
+            changed |= mergeTerminals(on, i + 1, terminals);
+            if (ops[i].code == SEQ_REPEAT)
+                changed |= mergeTerminals(on, ops[i].value, terminals);
+        }
+    }
+    return true;
+}
+
+// Known ops with arguments in range, jumps only backwards, one SEQ_END at the end,
+// and never MEAS_LR and MEAS_C on together
+bool isSequenceValid(const SEQ_OP *ops, uint8_t count)
+{
+    uint8_t i;
+
+    if (count == 0 || count > SEQ_MAX_OPS || ops[count - 1].code != SEQ_END)
+        return false;
+    for (i = 0; i < count - 1; i++)
+    {
+        switch (ops[i].code)
+        {
+            case SEQ_RESET:
+            case SEQ_WAIT:
+            case SEQ_DISCHARGE:
+            case SEQ_SAMPLE:
+                break;
+            case SEQ_SET:
+            case SEQ_CLEAR:
+                if (ops[i].arg & ~TERMINAL_ALL)
+                    return false;
+                break;
+            case SEQ_CAPTURE:
+                if (ops[i].arg > 1)
+                    return false;
+                break;
+            case SEQ_CONVERT:
+                if (ops[i].arg < SEQ_TABLE_RESISTANCE || ops[i].arg > SEQ_TABLE_INDUCTANCE)
+                    return false;
+                break;
+            case SEQ_REPEAT:
+                if (ops[i].arg == 0 || ops[i].value >= i)
+                    return false;
+                break;
+            default:
+                return false;
+        }
+    }
+    return isShootThroughFree(ops, count);
+}
+
+void clearSequenceEdit(void)
+{
+    sequenceEditCount = 0;
+}
+
+bool addSequenceOp(uint8_t code, uint8_t arg, uint32_t value)
+{
+    SEQ_OP *op = &sequenceEdit[sequenceEditCount];
+
+    if (sequenceEditCount >= SEQ_MAX_OPS || code >= SEQ_CODES)
+        return false;
+    op->code = code;
+    op->arg = arg;
+    op->reserved = 0;
+    op->value = value;
+    sequenceEditCount++;
+    return true;
+}
+
+const SEQ_OP * getSequenceEdit(uint8_t *count)
+{
+    *count = sequenceEditCount;
+    return sequenceEdit;
+}
+
+static uint32_t slotSum(const uint32_t *words, uint8_t count)
+{
+    uint32_t sum = 0;
+    uint16_t i;
+
+    for (i = 0; i < count * SEQ_OP_WORDS; i++)
+        sum += words[i];
+    return sum;
+}
+
+const SEQ_OP * getUserSequence(uint8_t slot, uint8_t *count)
+{
+    const uint32_t *words;
+    const SEQ_OP *ops;
+    uint8_t n;
+
+    if (slot >= SEQ_USER_SLOTS)
+        return 0;
+    words = getUserFlash() + slot * SEQ_SLOT_WORDS;
+    if ((words[0] & 0xFFFFFF00) != SEQ_SLOT_MAGIC)
+        return 0;
+    n = words[0] & 0xFF;
+    ops = (const SEQ_OP *)(words + SEQ_HEADER_WORDS);
+    if (n > SEQ_MAX_OPS || words[1] != slotSum(words + SEQ_HEADER_WORDS, n) || !isSequenceValid(ops, n))
+        return 0;
+    *count = n;
+    return ops;
+}
+
+// The page is erased as a whole, the other slots are copied across
+static bool writeSlot(uint8_t slot, const SEQ_OP *ops, uint8_t count)
+{
+    uint32_t page[USER_FLASH_WORDS];
+    uint32_t *words = page + slot * SEQ_SLOT_WORDS;
+
+    memcpy(page, getUserFlash(), sizeof(page));
+    memset(words, 0xFF, SEQ_SLOT_WORDS * 4);
+    if (count > 0)
+    {
+        memcpy(words + SEQ_HEADER_WORDS, ops, count * sizeof(SEQ_OP));
+        words[0] = SEQ_SLOT_MAGIC | count;
+        words[1] = slotSum(words + SEQ_HEADER_WORDS, count);
+    }
+    return writeUserFlash(page);
+}
+
+// Closes the uploaded program with SEQ_END if it isn't yet
+bool saveSequence(uint8_t slot)
+{
+    if (slot >= SEQ_USER_SLOTS)
+        return false;
+    if (sequenceEditCount == 0 || sequenceEdit[sequenceEditCount - 1].code != SEQ_END)
+        if (!addSequenceOp(SEQ_END, 0, 0))
+            return false;
+    if (!isSequenceValid(sequenceEdit, sequenceEditCount))
+        return false;
+    return writeSlot(slot, sequenceEdit, sequenceEditCount);
+}
+
+bool eraseSequence(uint8_t slot)
+{
+    if (slot >= SEQ_USER_SLOTS)
+        return false;
+    return writeSlot(slot, 0, 0);
+}
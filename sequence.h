@@ -0,0 +1,70 @@
+// LCR meter measurement sequences
+// Drive sequences as op tables: built-in ones in flash, user ones uploaded over UART
+
+#ifndef SEQUENCE_H_
+#define SEQUENCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+typedef enum _SEQ_CODE
+{
+    SEQ_END = 0,
+    SEQ_RESET,          // all output terminals off
+    SEQ_SET,            // arg: TERMINAL_* mask on
+    SEQ_CLEAR,          // arg: TERMINAL_* mask off
+    SEQ_WAIT,           // value: microseconds, on the wake timer
+    SEQ_DISCHARGE,      // short the DUT until it holds no charge
+    SEQ_CAPTURE,        // arg: 0 one threshold, 1 stepped; value: window in microseconds
+    SEQ_CONVERT,        // arg: SEQ_TABLE, ticks to value
+    SEQ_SAMPLE,         // averaged DUT1/DUT2 into the result volts
+    SEQ_REPEAT,         // arg: passes, value: op index to go back to
+    SEQ_CODES
+} SEQ_CODE;
+
+typedef enum _SEQ_TABLE
+{
+    SEQ_TABLE_RESISTANCE = 1,
+    SEQ_TABLE_CAPACITANCE,
+    SEQ_TABLE_INDUCTANCE
+} SEQ_TABLE;
+
+// One op, 8 bytes, stored as is in flash
+typedef struct _SEQ_OP
+{
+    uint8_t code;
+    uint8_t arg;
+    uint16_t reserved;
+    uint32_t value;
+} SEQ_OP;
+
+#define SEQ_MAX_OPS         31    // a user slot is 256 bytes: header and 31 ops
+#define SEQ_USER_SLOTS      4
+
+// Built-in sequences
+extern const SEQ_OP seqResistance[];
+extern const SEQ_OP seqCapacitance[];
+extern const SEQ_OP seqInductance[];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char * getSequenceOpName(uint8_t code);
+bool isSequenceValid(const SEQ_OP *ops, uint8_t count);
+
+// Program being uploaded, one op at a time
+void clearSequenceEdit(void);
+bool addSequenceOp(uint8_t code, uint8_t arg, uint32_t value);
+const SEQ_OP * getSequenceEdit(uint8_t *count);
+
+// User slots in the reserved flash page, 0 when the slot is empty
+bool saveSequence(uint8_t slot);
+bool eraseSequence(uint8_t slot);
+const SEQ_OP * getUserSequence(uint8_t slot, uint8_t *count);
+
+#endif /* SEQUENCE_H_ */
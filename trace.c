@@ -0,0 +1,122 @@
+// LCR meter drive trace
+// Records every output terminal write with a system clock timestamp and exports
+// the buffer as a VCD waveform
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock.h"
+#include "hal.h"
+#include "trace.h"
+
+static const char * const terminalNames[5] = {"meas_lr", "meas_c", "highside_r", "lowside_r", "integrate"};
+static const char terminalIds[5] = {'!', '"', '#', '$', '%'};
+
+TRACE_EVENT traceEvents[TRACE_DEPTH];
+uint16_t traceCount = 0;
+uint32_t traceDropped = 0;
+uint32_t traceTicksPerUs = 40;
+volatile bool traceRunning = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void startTrace(void)
+{
+    traceRunning = false;
+    traceCount = 0;
+    traceDropped = 0;
+    traceTicksPerUs = getTicksPerUs();
+    traceRunning = true;
+    traceTerminals(getTerminals());
+}
+
+void stopTrace(void)
+{
+    traceRunning = false;
+}
+
+bool isTraceRunning(void)
+{
+    return traceRunning;
+}
+
+// Kept short, it runs between the port writes it measures
+void traceTerminals(uint8_t terminals)
+{
+    if (!traceRunning)
+        return;
+    if (traceCount >= TRACE_DEPTH)
+    {
+        traceDropped++;
+        return;
+    }
+    traceEvents[traceCount].ticks = getTraceTicks();
+    traceEvents[traceCount].terminals = terminals;
+    traceCount++;
+}
+
+uint16_t getTraceCount(void)
+{
+    return traceCount;
+}
+
+uint32_t getTraceDropped(void)
+{
+    return traceDropped;
+}
+
+const TRACE_EVENT * getTraceEvent(uint16_t index)
+{
+    return index < traceCount ? &traceEvents[index] : 0;
+}
+
+// Times in nanoseconds from the first event, one time marker per distinct time
+void writeTraceVcd(TRACE_PRINT print)
+{
+    char line[48];
+    uint64_t elapsed = 0;
+    uint64_t ns;
+    uint64_t written = 0;
+    uint8_t previous = 0;
+    uint16_t i;
+    uint8_t j;
+
+    print("$timescale 1ns $end\n$scope module lcr $end\n");
+    for (j = 0; j < 5; j++)
+    {
+        sprintf(line, "$var wire 1 %c %s $end\n", terminalIds[j], terminalNames[j]);
+        print(line);
+    }
+    print("$upscope $end\n$enddefinitions $end\n");
+
+    for (i = 0; i < traceCount; i++)
+    {
+        if (i > 0)
+            elapsed += (uint32_t)(traceEvents[i].ticks - traceEvents[i - 1].ticks);
+        ns = elapsed * 1000 / traceTicksPerUs;
+        if (i == 0 || ns != written)
+        {
+            sprintf(line, "#%llu\n", (unsigned long long)ns);
+            print(line);
+            written = ns;
+        }
+        if (i == 0)
+            print("$dumpvars\n");
+        for (j = 0; j < 5; j++)
+        {
+            if (i == 0 || ((traceEvents[i].terminals ^ previous) & (1 << j)))
+            {
+                sprintf(line, "%c%c\n", (traceEvents[i].terminals & (1 << j)) ? '1' : '0', terminalIds[j]);
+                print(line);
+            }
+        }
+        if (i == 0)
+            print("$end\n");
+        previous = traceEvents[i].terminals;
+    }
+}
@@ -0,0 +1,46 @@
+// LCR meter drive trace
+// Records every output terminal write with a system clock timestamp and exports
+// the buffer as a VCD waveform
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TRACE_DEPTH         256   // events, later ones are counted as dropped
+
+// Terminal state (TERMINAL_* bits) right after one port write
+typedef struct _TRACE_EVENT
+{
+    uint32_t ticks;               // system clock, wraps; only differences are used
+    uint8_t terminals;
+} TRACE_EVENT;
+
+// Export sink, putsUart0 on target and stdout on the host
+typedef void (*TRACE_PRINT)(char *str);
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// startTrace empties the buffer, the first event is the current state
+void startTrace(void);
+void stopTrace(void);
+bool isTraceRunning(void);
+
+// Called by the hal after every write to an output port
+void traceTerminals(uint8_t terminals);
+
+uint16_t getTraceCount(void);
+uint32_t getTraceDropped(void);
+const TRACE_EVENT * getTraceEvent(uint16_t index);
+
+// Gaps between events must stay under 2^32 ticks (107 s at 40 MHz)
+void writeTraceVcd(TRACE_PRINT print);
+
+#endif /* TRACE_H_ */
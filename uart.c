@@ -0,0 +1,301 @@
+// LCR meter UART0 link
+// Virtual COM port through the ICDI, baud divisors derived from the UART clock
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    see clock.c
+
+// Hardware configuration:
+// UART Interface:
+//   U0TX (PA1) and U0RX (PA0) are connected to the 2nd controller
+//   The USB on the 2nd controller enumerates to an ICDI interface and a virtual COM port
+//   Configured to 115,200 baud, 8N1 by default
+//   RX and RX-timeout interrupts move received characters into a software buffer
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "power.h"
+#include "uart.h"
+
+// precision internal oscillator, used as UART clock in deep-sleep
+#define PIOSC_HZ            16000000
+
+// baud negotiation
+#define BAUD_MIN                9600
+#define BAUD_MAX_ERROR_PERMILLE 20        // receivers tolerate a few percent of rate error
+#define BAUD_CONFIRM_US         2000000   // host has this long to answer at the new rate
+#define BAUD_POLL_US            10
+#define FRAMING_ERROR_LIMIT     3         // consecutive bad characters before falling back
+
+// receive buffer, written by uart0Isr and read by getcUart0 (size is a power of 2)
+#define RX_BUFFER_SIZE          256
+
+uint32_t uart0Baud = UART0_DEFAULT_BAUD;
+bool uart0OnPiosc = false;
+uint8_t framingErrors = 0;
+uint32_t baudFallbacks = 0;
+
+char rxBuffer[RX_BUFFER_SIZE];
+volatile uint16_t rxWriteIndex = 0;
+volatile uint16_t rxReadIndex = 0;
+volatile bool baudFallbackPending = false;
+uint32_t rxOverflows = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initUart0(uint32_t baud)
+{
+    // Configure UART0 pins
+    SYSCTL_RCGCUART_R |= SYSCTL_RCGCUART_R0;         // turn-on UART0, leave other uarts in same status
+    GPIO_PORTA_DEN_R |= 3;                           // default, added for clarity
+    GPIO_PORTA_AFSEL_R |= 3;                         // default, added for clarity
+    GPIO_PORTA_PCTL_R |= GPIO_PCTL_PA1_U0TX | GPIO_PCTL_PA0_U0RX;
+
+    setUart0Baud(baud);
+
+    // interrupt on the first character, or when a shorter burst goes quiet
+    UART0_IFLS_R = UART_IFLS_RX1_8;
+    UART0_IM_R |= UART_IM_RXIM | UART_IM_RTIM;
+    NVIC_EN0_R |= 1 << (INT_UART0-16);               // turn-on interrupt 21 (UART0)
+}
+
+static uint32_t getUart0ClockHz(void)
+{
+    return uart0OnPiosc ? PIOSC_HZ : getSysClockHz();
+}
+
+// High-speed mode (N=8) is only used once the N=16 divisor would drop below 1
+static bool isHighSpeedBaud(uint32_t clock, uint32_t baud)
+{
+    return baud > clock / 16;
+}
+
+// r = clock / (N x baud), kept in 1/64ths and rounded: IBRD = floor(r), FBRD = round(fract(r)*64)
+static uint32_t getBaudDivisor(uint32_t clock, uint32_t baud)
+{
+    if (isHighSpeedBaud(clock, baud))
+        return (((clock * 16) / baud) + 1) / 2;     // N=8
+    return (((clock * 8) / baud) + 1) / 2;          // N=16
+}
+
+// Configure UART0 to baud, 8N1 format (must be 3 clocks from clock enable and config writes)
+void setUart0Baud(uint32_t baud)
+{
+    uint32_t clock = getUart0ClockHz();
+    uint32_t divisor = getBaudDivisor(clock, baud);
+    uint32_t highSpeed = isHighSpeedBaud(clock, baud) ? UART_CTL_HSE : 0;
+
+    flushUart0();                                    // let the last character drain
+    UART0_CTL_R = 0;                                 // turn-off UART0 to allow safe programming
+    UART0_CC_R = uart0OnPiosc ? UART_CC_CS_PIOSC : UART_CC_CS_SYSCLK;
+    UART0_IBRD_R = divisor >> 6;
+    UART0_FBRD_R = divisor & 0x3F;
+    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // configure for 8N1 w/ 16-level FIFO, also latches the divisors
+    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN | highSpeed; // enable TX, RX, and module
+
+    uart0Baud = baud;
+    framingErrors = 0;
+    baudFallbackPending = false;
+}
+
+// A rate is usable if the divisor is in range and the rounded rate is within tolerance
+bool isUart0BaudSupported(uint32_t baud)
+{
+    uint32_t clock = getUart0ClockHz();
+    uint32_t divisor;
+    uint32_t actual;
+    uint32_t error;
+
+    if (baud < BAUD_MIN || baud > clock / 8)
+        return false;
+
+    divisor = getBaudDivisor(clock, baud);
+    if ((divisor >> 6) == 0 || (divisor >> 6) > 0xFFFF)
+        return false;
+
+    actual = isHighSpeedBaud(clock, baud) ? ((clock / divisor) * 8) : ((clock / divisor) * 4);
+    error = actual > baud ? actual - baud : baud - actual;
+    return (error * 1000) / baud <= BAUD_MAX_ERROR_PERMILLE;
+}
+
+// Drop everything received so far
+static void discardUart0Rx(void)
+{
+    rxReadIndex = rxWriteIndex;
+}
+
+// Receive with a timeout, returns -1 on timeout and -2 on a line error
+static int16_t getcUart0Timeout(uint32_t us)
+{
+    char c;
+
+    while (!kbhitUart0())
+    {
+        if (baudFallbackPending)
+            return -2;
+        if (us < BAUD_POLL_US)
+            return -1;
+        waitMicrosecond(BAUD_POLL_US);
+        us -= BAUD_POLL_US;
+    }
+    c = rxBuffer[rxReadIndex];
+    rxReadIndex = (rxReadIndex + 1) & (RX_BUFFER_SIZE - 1);
+    return c;
+}
+
+// Announce the new rate at the old one, switch, and keep it only if the host answers
+// "ok" followed by a carriage return at the new rate. Anything else restores the old rate.
+bool negotiateUart0Baud(uint32_t baud)
+{
+    char reply[4];
+    uint8_t count = 0;
+    uint32_t previous = uart0Baud;
+    int16_t c;
+
+    putsUart0("\r\n baud switching\r\n");
+    setUart0Baud(baud);
+
+    // drop whatever arrived while the host was switching
+    discardUart0Rx();
+
+    while (count < sizeof(reply))
+    {
+        c = getcUart0Timeout(BAUD_CONFIRM_US);
+        if (c < 0)
+            break;
+        if (c == 0x0D)
+        {
+            reply[count] = 0x0;
+            break;
+        }
+        if (c >= 0x20)
+            reply[count++] = tolower(c);
+    }
+
+    if (c == 0x0D && !strcmp(reply, "ok"))
+    {
+        putsUart0("\r\n baud ok\r\n");
+        return true;
+    }
+
+    setUart0Baud(previous);
+    baudFallbacks++;
+    putsUart0("\r\n baud failed\r\n");
+    return false;
+}
+
+uint32_t getUart0BaudFallbacks(void)
+{
+    return baudFallbacks;
+}
+
+// Deep-sleep runs from PIOSC, so UART0 has to as well to keep hearing the host
+void setUart0ClockSource(bool piosc)
+{
+    uart0OnPiosc = piosc;
+    setUart0Baud(uart0Baud);
+}
+
+uint32_t getUart0Baud(void)
+{
+    return uart0Baud;
+}
+
+// Blocking function that returns once the TX FIFO and shift register are empty
+void flushUart0(void)
+{
+    while (UART0_FR_R & UART_FR_BUSY);
+}
+
+// Blocking function that writes a serial character when the UART buffer is not full
+void putcUart0(char c)
+{
+    while (UART0_FR_R & UART_FR_TXFF);
+    UART0_DR_R = c;
+}
+
+// Blocking function that writes a string when the UART buffer is not full
+void putsUart0(char* str)
+{
+    while (*str)
+      putcUart0(*str++);
+}
+
+// True when a received character is waiting
+bool kbhitUart0(void)
+{
+    return rxReadIndex != rxWriteIndex;
+}
+
+uint32_t getUart0RxOverflows(void)
+{
+    return rxOverflows;
+}
+
+// Blocking function that returns with serial data once the buffer is not empty
+// The core sleeps (see power.c) while nothing has been received
+// Repeated framing errors or a break from the host drop the link back to the default rate
+char getcUart0()
+{
+    char c;
+
+    while (1)
+    {
+        if (baudFallbackPending)
+        {
+            baudFallbackPending = false;
+            setUart0Baud(UART0_DEFAULT_BAUD);
+            baudFallbacks++;
+        }
+        if (kbhitUart0())
+            break;
+        powerIdle();
+    }
+    c = rxBuffer[rxReadIndex];
+    rxReadIndex = (rxReadIndex + 1) & (RX_BUFFER_SIZE - 1);
+    return c;
+}
+
+// Moves the RX FIFO into the receive buffer, line errors are counted here and the
+// rate fallback is left to getcUart0 so the ISR never waits on the transmitter
+void uart0Isr(void)
+{
+    uint32_t data;
+    uint16_t next;
+
+    UART0_ICR_R = UART_ICR_RXIC | UART_ICR_RTIC;
+    while (!(UART0_FR_R & UART_FR_RXFE))
+    {
+        data = UART0_DR_R;
+        if (data & (UART_DR_FE | UART_DR_BE))
+        {
+            UART0_ECR_R = 0;
+            if (uart0Baud != UART0_DEFAULT_BAUD && ((data & UART_DR_BE) || ++framingErrors >= FRAMING_ERROR_LIMIT))
+                baudFallbackPending = true;
+            continue;
+        }
+        framingErrors = 0;
+
+        next = (rxWriteIndex + 1) & (RX_BUFFER_SIZE - 1);
+        if (next == rxReadIndex)
+        {
+            rxOverflows++;
+            continue;
+        }
+        rxBuffer[rxWriteIndex] = data & 0xFF;
+        rxWriteIndex = next;
+    }
+}
@@ -0,0 +1,43 @@
+// LCR meter UART0 link
+// Virtual COM port through the ICDI, baud divisors derived from the UART clock
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define UART0_DEFAULT_BAUD  115200
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initUart0(uint32_t baud);
+
+// Re-derive IBRD/FBRD, call after the system clock or the UART clock source changes
+void setUart0Baud(uint32_t baud);
+void setUart0ClockSource(bool piosc);
+uint32_t getUart0Baud(void);
+
+// Host handshake for changing the link rate, see README.md
+bool isUart0BaudSupported(uint32_t baud);
+bool negotiateUart0Baud(uint32_t baud);
+uint32_t getUart0BaudFallbacks(void);
+
+void flushUart0(void);
+void putcUart0(char c);
+void putsUart0(char* str);
+
+// Reception is interrupt driven into a software buffer
+bool kbhitUart0(void);
+char getcUart0();
+uint32_t getUart0RxOverflows(void);
+
+void uart0Isr(void);
+
+#endif /* UART_H_ */